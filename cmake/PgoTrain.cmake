@@ -0,0 +1,38 @@
+# PGO training run: every tool encodes and decodes the corpus through the
+# one-shot, streaming, threaded and pipeline paths.
+#   cmake -DTOOLS_DIR=<dir> -DCORPUS=<file> -DWORK_DIR=<dir> -P PgoTrain.cmake
+
+if(NOT EXISTS "${CORPUS}")
+    message(FATAL_ERROR "PGO corpus [${CORPUS}] not found")
+endif()
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+foreach(tool base64 base16 base32 base85 z85)
+    set(exe ${TOOLS_DIR}/${tool})
+    set(enc ${WORK_DIR}/${tool}.enc)
+    message(STATUS "Training ${tool}")
+    execute_process(COMMAND ${exe} -b 50 -f ${CORPUS} OUTPUT_QUIET ERROR_QUIET)
+    execute_process(COMMAND ${exe} -t 0 -f ${CORPUS} -o ${enc} OUTPUT_QUIET ERROR_QUIET)
+    if(EXISTS ${enc})
+        execute_process(COMMAND ${exe} -d -b 50 -f ${enc} OUTPUT_QUIET ERROR_QUIET)
+        execute_process(COMMAND ${exe} -d -t 0 -f ${enc} -o ${WORK_DIR}/${tool}.dec OUTPUT_QUIET ERROR_QUIET)
+    endif()
+endforeach()
+
+# Wrapped input, random access and the compression pipeline.
+execute_process(COMMAND ${TOOLS_DIR}/base64 --gzip -f ${CORPUS} -o ${WORK_DIR}/gzip.enc OUTPUT_QUIET ERROR_QUIET)
+execute_process(COMMAND ${TOOLS_DIR}/base64 -d --gzip -f ${WORK_DIR}/gzip.enc -o ${WORK_DIR}/gzip.dec
+                OUTPUT_QUIET ERROR_QUIET)
+# Only a fixed prefix is wrapped: the regex over the whole encoded corpus
+# is slow and holds several copies of it in memory.
+set(WRAP_SAMPLE 1048576)
+file(READ ${WORK_DIR}/base64.enc b64 LIMIT ${WRAP_SAMPLE})
+set(line "")
+foreach(i RANGE 1 76)
+    string(APPEND line ".")
+endforeach()
+string(REGEX REPLACE "(${line})" "\\1\n" wrapped "${b64}")
+file(WRITE ${WORK_DIR}/wrapped.enc "${wrapped}")
+execute_process(COMMAND ${TOOLS_DIR}/base64 -d -b 50 -f ${WORK_DIR}/wrapped.enc OUTPUT_QUIET ERROR_QUIET)
+execute_process(COMMAND ${TOOLS_DIR}/base64 --range=1000:100000 -f ${WORK_DIR}/wrapped.enc -o ${WORK_DIR}/range.dec
+                OUTPUT_QUIET ERROR_QUIET)
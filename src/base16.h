@@ -0,0 +1,22 @@
+#ifndef __BASE16_H__
+#define __BASE16_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "codec.h"
+
+int32_t base16_encode(const void *src, size_t srclength, void *dest, size_t targsize);
+int32_t base16_decode(const void *src, size_t srclength, void *dest, size_t targsize);
+int32_t base16_set_key(const char *key);
+
+size_t base16_encode_len(size_t srclength);
+size_t base16_decode_len(size_t srclength);
+
+extern const struct codec_ops base16_ops;
+
+#endif
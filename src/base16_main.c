@@ -0,0 +1,6 @@
+#include "codec.h"
+#include "base16.h"
+
+int main(int argc, char **argv) {
+    return codec_main(&base16_ops, argc, argv);
+}
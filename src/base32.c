@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BASE32_HAVE_SSSE3 1
+#endif
+
+#include "kernel.h"
+#include "base32.h"
+
+/* (From RFC 4648, section 6)
+   The encoding process represents 40-bit groups of input bits as output
+   strings of 8 encoded characters.  Proceeding from left to right, a
+   40-bit input group is formed by concatenating 5 8bit input groups.
+   These 40 bits are then treated as 8 concatenated 5-bit groups, each
+   of which is translated into a single character in the base 32
+   alphabet.  When a bit stream is encoded via the base 32 encoding, the
+   bit stream must be presumed to be ordered with the most-significant-
+   bit first.
+
+   Special processing is performed if fewer than 40 bits are available
+   at the end of the data being encoded.  A full encoding quantum is
+   always completed at the end of a body.  When fewer than 40 input bits
+   are available in an input group, bits with value zero are added (on
+   the right) to form an integral number of 5-bit groups.  Padding at
+   the end of the data is performed using the "=" character.
+ */
+
+#define BASE32_LEN 32
+static char BASE32_CHARS[BASE32_LEN + 1] = {"ABCDEFGHIJKLMNOPQRSTUVWXYZ234567"};
+static const char base32_enc_pad = '=';
+
+/* Decode table values besides 0..31. */
+#define BASE32_DEC_SPACE (0x40)
+#define BASE32_DEC_PAD (0x80)
+#define BASE32_DEC_INVALID (0xFF)
+
+static uint8_t base32_dec_map[256];
+static bool base32_std_alphabet = true;
+
+__attribute__((constructor)) static void base32_build_dec_map(void) {
+    int32_t i = 0, ch = 0;
+
+    memset(base32_dec_map, BASE32_DEC_INVALID, sizeof(base32_dec_map));
+    for (i = 0; i < 256; i++) {
+        if (isspace(i)) {
+            base32_dec_map[i] = BASE32_DEC_SPACE;
+        }
+    }
+    base32_dec_map[(uint8_t)base32_enc_pad] = BASE32_DEC_PAD;
+    for (i = 0; i < BASE32_LEN; i++) {
+        base32_dec_map[(uint8_t)BASE32_CHARS[i]] = i;
+    }
+    /* Letters are case insensitive unless the alphabet uses both cases. */
+    for (i = 0; i < BASE32_LEN; i++) {
+        ch = (uint8_t)BASE32_CHARS[i];
+        if (isupper(ch) && base32_dec_map[tolower(ch)] == BASE32_DEC_INVALID) {
+            base32_dec_map[tolower(ch)] = i;
+        } else if (islower(ch) && base32_dec_map[toupper(ch)] == BASE32_DEC_INVALID) {
+            base32_dec_map[toupper(ch)] = i;
+        }
+    }
+}
+
+int32_t base32_set_key(const char *key) {
+    int32_t i = 0, j = 0;
+
+    if ((key == NULL) || (strlen(key) < BASE32_LEN)) {
+        return -1;
+    }
+    /* Every character has to be unique or decoding is ambiguous. */
+    for (i = 0; i < BASE32_LEN; i++) {
+        if (key[i] == base32_enc_pad || isspace((uint8_t)key[i])) {
+            return -1;
+        }
+        for (j = i + 1; j < BASE32_LEN; j++) {
+            if (key[i] == key[j]) {
+                return -1;
+            }
+        }
+    }
+    strncpy(BASE32_CHARS, key, BASE32_LEN);
+    base32_std_alphabet = (memcmp(BASE32_CHARS, "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567", BASE32_LEN) == 0);
+    base32_build_dec_map();
+    return 0;
+}
+
+#ifdef BASE32_HAVE_SSSE3
+/*
+ * Two 5 byte groups per iteration.  Every output character is a 5-bit field
+ * that lies inside one big endian 16-bit word of the input, pshufb gathers
+ * those words, a per-lane power of two mulhi shifts each field down and the
+ * result is mapped to 'A'..'Z', '2'..'7' arithmetically.  Needs 16 readable
+ * input bytes per 10 consumed, the tail is left to the scalar loop.
+ */
+__attribute__((target("ssse3"))) static size_t base32_encode_ssse3(const uint8_t *src, size_t srclength, char *dest) {
+    const __m128i shuf0 = _mm_setr_epi8(1, 0, 1, 0, 2, 1, 2, 1, 3, 2, 4, 3, 4, 3, 5, 4);
+    const __m128i shuf1 = _mm_setr_epi8(6, 5, 6, 5, 7, 6, 7, 6, 8, 7, 9, 8, 9, 8, 10, 9);
+    const __m128i shift = _mm_setr_epi16(1 << 5, 1 << 10, 1 << 7, 1 << 12, 1 << 9, 1 << 6, 1 << 11, 1 << 8);
+    const __m128i mask = _mm_set1_epi16(0x1F);
+    const __m128i letters = _mm_set1_epi8(25);
+    const __m128i base = _mm_set1_epi8('A');
+    const __m128i digits = _mm_set1_epi8('2' - 26 - 'A');
+    size_t done = 0;
+
+    while (srclength - done >= 16) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(src + done));
+        __m128i lo = _mm_and_si128(_mm_mulhi_epu16(_mm_shuffle_epi8(in, shuf0), shift), mask);
+        __m128i hi = _mm_and_si128(_mm_mulhi_epu16(_mm_shuffle_epi8(in, shuf1), shift), mask);
+        __m128i idx = _mm_packus_epi16(lo, hi);
+        __m128i out = _mm_add_epi8(idx, base);
+        out = _mm_add_epi8(out, _mm_and_si128(_mm_cmpgt_epi8(idx, letters), digits));
+        _mm_storeu_si128((__m128i *)dest, out);
+        done += 10;
+        dest += 16;
+    }
+    return done;
+}
+#endif
+
+CODEC_KERNEL int32_t base32_encode(const void *src, size_t srclength, void *dest, size_t targsize) {
+    const uint8_t *_src_ = src;
+    char *target = dest;
+    size_t datalength = 0, done = 0, i = 0, chars = 0;
+    uint64_t group = 0;
+
+    if (((srclength + 4) / 5) * 8 >= targsize) {
+        return (-1);
+    }
+
+#ifdef BASE32_HAVE_SSSE3
+    if (base32_std_alphabet && __builtin_cpu_supports("ssse3")) {
+        done = base32_encode_ssse3(_src_, srclength, target);
+        _src_ += done;
+        srclength -= done;
+        datalength = done / 5 * 8;
+    }
+#endif
+
+    while (4 < srclength) {
+        group = ((uint64_t)_src_[0] << 32) | ((uint64_t)_src_[1] << 24) | ((uint64_t)_src_[2] << 16) |
+                ((uint64_t)_src_[3] << 8) | (uint64_t)_src_[4];
+        _src_ += 5;
+        srclength -= 5;
+
+        for (i = 0; i < 8; i++) {
+            target[datalength++] = BASE32_CHARS[(group >> (35 - i * 5)) & 0x1F];
+        }
+    }
+
+    /* Now we worry about padding. */
+    if (0 != srclength) {
+        group = 0;
+        for (i = 0; i < 5; i++) {
+            group = (group << 8) | (i < srclength ? _src_[i] : 0);
+        }
+        /* 1..4 input bytes give 2, 4, 5 or 7 significant characters. */
+        chars = (srclength * 8 + 4) / 5;
+        for (i = 0; i < 8; i++) {
+            target[datalength++] = (i < chars) ? BASE32_CHARS[(group >> (35 - i * 5)) & 0x1F] : base32_enc_pad;
+        }
+    }
+    target[datalength] = '\0'; /* Returned value doesn't count \0. */
+    return (datalength);
+}
+
+/* skips all whitespace anywhere, trailing padding is optional.
+   it returns the number of data bytes stored at the target, or -1 on error.
+ */
+CODEC_KERNEL int32_t base32_decode(const void *src, size_t srclength, void *dest, size_t targsize) {
+    const uint8_t *_src_ = src;
+    uint8_t *target = dest;
+    size_t tarindex = 0, i = 0;
+    uint64_t bits = 0;
+    uint32_t nbits = 0;
+    uint8_t v = 0;
+
+    for (i = 0; i < srclength; i++) {
+        v = base32_dec_map[_src_[i]];
+        if (v < BASE32_LEN) {
+            bits = (bits << 5) | v;
+            nbits += 5;
+            if (nbits >= 8) {
+                nbits -= 8;
+                if (tarindex >= targsize)
+                    return (-1);
+                target[tarindex++] = (uint8_t)(bits >> nbits);
+            }
+        } else if (v == BASE32_DEC_SPACE) {
+            continue;
+        } else if (v == BASE32_DEC_PAD) {
+            break;
+        } else if (_src_[i] == '\0') {
+            break;
+        } else {
+            return (-1); /* A non-base32 character. */
+        }
+    }
+
+    /* Only padding and whitespace may follow the first pad character. */
+    for (; i < srclength && _src_[i] != '\0'; i++) {
+        v = base32_dec_map[_src_[i]];
+        if (v != BASE32_DEC_PAD && v != BASE32_DEC_SPACE)
+            return (-1);
+    }
+
+    /*
+     * 1, 3 or 6 characters in the last group can't come from whole bytes,
+     * and the bits that slopped past the last byte must be zero or they
+     * become a subliminal channel.
+     */
+    if (nbits >= 5 || (bits & ((1u << nbits) - 1)) != 0)
+        return (-1);
+
+    /* Null-terminate if we have room left */
+    if (tarindex < targsize)
+        target[tarindex] = 0;
+
+    return (tarindex);
+}
+
+size_t base32_encode_len(size_t srclength) {
+    return ((srclength + 4) / 5) * 8 + 1;
+}
+
+size_t base32_decode_len(size_t srclength) {
+    return (srclength / 8) * 5 + 5;
+}
+
+const struct codec_ops base32_ops = {
+    .name = "Base32",
+    .enc_block = 5,
+    .dec_block = 8,
+    .pad = '=',
+    .encode_len = base32_encode_len,
+    .decode_len = base32_decode_len,
+    .encode = base32_encode,
+    .decode = base32_decode,
+    .set_key = base32_set_key,
+};
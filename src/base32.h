@@ -0,0 +1,22 @@
+#ifndef __BASE32_H__
+#define __BASE32_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "codec.h"
+
+int32_t base32_encode(const void *src, size_t srclength, void *dest, size_t targsize);
+int32_t base32_decode(const void *src, size_t srclength, void *dest, size_t targsize);
+int32_t base32_set_key(const char *key);
+
+size_t base32_encode_len(size_t srclength);
+size_t base32_decode_len(size_t srclength);
+
+extern const struct codec_ops base32_ops;
+
+#endif
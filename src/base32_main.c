@@ -0,0 +1,6 @@
+#include "codec.h"
+#include "base32.h"
+
+int main(int argc, char **argv) {
+    return codec_main(&base32_ops, argc, argv);
+}
@@ -17,11 +17,24 @@
 #include <sys/file.h>
 #include <sys/time.h>
 
+#include "kernel.h"
 #include "base64.h"
 
 static const char base64_enc_map[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 static const char base64_enc_pad = '=';
 
+/* Alphabet index of every character, 0xFF for anything else. */
+static uint8_t base64_dec_map[256];
+
+__attribute__((constructor)) static void base64_dec_map_init(void) {
+    int32_t i = 0;
+
+    memset(base64_dec_map, 0xFF, sizeof(base64_dec_map));
+    for (i = 0; i < 64; i++) {
+        base64_dec_map[(uint8_t)base64_enc_map[i]] = i;
+    }
+}
+
 /* (From RFC1521 and draft-ietf-dnssec-secext-03.txt)
    The following encoding technique is taken from RFC 1521 by Borenstein
    and Freed.  It is reproduced here in a slightly edited form for
@@ -85,7 +98,7 @@ static const char base64_enc_pad = '=';
        characters followed by one "=" padding character.
    */
 
-int32_t base64_encode(const void *src, size_t srclength, void *dest, size_t targsize) {
+CODEC_KERNEL int32_t base64_encode(const void *src, size_t srclength, void *dest, size_t targsize) {
     const uint8_t *_src_ = src;
     char *target = dest;
     size_t datalength = 0;
@@ -142,10 +155,41 @@ int32_t base64_encode(const void *src, size_t srclength, void *dest, size_t targ
 /* skips all whitespace anywhere.
    converts characters, four at a time, starting at (or after)
    src from base - 64 numbers into three 8 bit bytes in the target area.
+   stops after srclength characters or at the first '\0', whichever is first.
    it returns the number of data bytes stored at the target, or -1 on error.
  */
-int32_t base64_decode(const void *src, void *dest, size_t targsize) {
+#define BASE64_NEXT_CHAR() ((_src_ < _end_) ? (uint8_t)*_src_++ : '\0')
+
+/*
+ * Fast path for dense input: whole groups of four alphabet characters
+ * through the lookup table.  Stops in front of the first group holding
+ * whitespace, padding or anything invalid, which the character at a time
+ * loop then handles, and returns the new output length.
+ */
+static inline int32_t base64_decode_dense(const char **src, const char *end, uint8_t *target, int32_t tarindex,
+                                          size_t targsize) {
+    const char *_src_ = *src;
+    uint8_t a = 0, b = 0, c = 0, d = 0;
+
+    while ((end - _src_ >= 4) && ((size_t)tarindex + 3 <= targsize)) {
+        a = base64_dec_map[(uint8_t)_src_[0]];
+        b = base64_dec_map[(uint8_t)_src_[1]];
+        c = base64_dec_map[(uint8_t)_src_[2]];
+        d = base64_dec_map[(uint8_t)_src_[3]];
+        if ((a | b | c | d) & 0xC0)
+            break;
+        target[tarindex++] = (a << 2) | (b >> 4);
+        target[tarindex++] = (b << 4) | (c >> 2);
+        target[tarindex++] = (c << 6) | d;
+        _src_ += 4;
+    }
+    *src = _src_;
+    return tarindex;
+}
+
+CODEC_KERNEL int32_t base64_decode(const void *src, size_t srclength, void *dest, size_t targsize) {
     const char *_src_ = src;
+    const char *_end_ = _src_ + srclength;
     uint8_t *target = dest;
     int32_t tarindex = 0, state = 0, ch = 0;
     uint8_t nextbyte = 0;
@@ -154,7 +198,12 @@ int32_t base64_decode(const void *src, void *dest, size_t targsize) {
     state = 0;
     tarindex = 0;
 
-    while ((ch = (uint8_t)*_src_++) != '\0') {
+    for (;;) {
+        if (state == 0 && target)
+            tarindex = base64_decode_dense(&_src_, _end_, target, tarindex, targsize);
+        if ((ch = BASE64_NEXT_CHAR()) == '\0')
+            break;
+
         if (isspace(ch)) /* Skip whitespace anywhere. */
             continue;
 
@@ -220,7 +269,7 @@ int32_t base64_decode(const void *src, void *dest, size_t targsize) {
      */
 
     if (ch == base64_enc_pad) { /* We got a pad char. */
-        ch = (uint8_t)*_src_++; /* Skip it, get next. */
+        ch = BASE64_NEXT_CHAR(); /* Skip it, get next. */
         switch (state) {
             case 0: /* Invalid = in first position */
             case 1: /* Invalid = in second position */
@@ -228,13 +277,13 @@ int32_t base64_decode(const void *src, void *dest, size_t targsize) {
 
             case 2: /* Valid, means one byte of info */
                 /* Skip any number of spaces. */
-                for (; ch != '\0'; ch = (uint8_t)*_src_++)
+                for (; ch != '\0'; ch = BASE64_NEXT_CHAR())
                     if (!isspace(ch))
                         break;
                 /* Make sure there is another trailing = sign. */
                 if (ch != base64_enc_pad)
                     return (-1);
-                ch = (uint8_t)*_src_++; /* Skip the = */
+                ch = BASE64_NEXT_CHAR(); /* Skip the = */
                                         /* Fall through to "single trailing =" case. */
                                         /* FALLTHROUGH */
 
@@ -243,7 +292,7 @@ int32_t base64_decode(const void *src, void *dest, size_t targsize) {
              * We know this char is an =.  Is there anything but
              * whitespace after it?
              */
-                for (; ch != '\0'; ch = (uint8_t)*_src_++)
+                for (; ch != '\0'; ch = BASE64_NEXT_CHAR())
                     if (!isspace(ch))
                         return (-1);
 
@@ -272,6 +321,26 @@ int32_t base64_decode(const void *src, void *dest, size_t targsize) {
     return (tarindex);
 }
 
+size_t base64_encode_len(size_t srclength) {
+    return ((srclength + 2) / 3) * 4 + 1;
+}
+
+size_t base64_decode_len(size_t srclength) {
+    return (srclength / 4) * 3 + 3;
+}
+
+const struct codec_ops base64_ops = {
+    .name = "Base64",
+    .enc_block = 3,
+    .dec_block = 4,
+    .pad = '=',
+    .encode_len = base64_encode_len,
+    .decode_len = base64_decode_len,
+    .encode = base64_encode,
+    .decode = base64_decode,
+    .ct = &base64_ct_ops,
+};
+
 #if 0
 static const uint8_t base64_test_dec[] = {"QmFzZTY0IGVuY29kaW5nIHRlc3QgcGFzc2VkIVFtRnpaVFkwSUdWdVkyOWthVzVuSUhSbGMzUWdjR0Z6YzJWa0lRPT1RbUZ6WlRZMElHVnVZMj"}; // don't include '\0'
 static const uint8_t base64_test_enc[] = {"UW1GelpUWTBJR1Z1WTI5a2FXNW5JSFJsYzNRZ2NHRnpjMlZrSVZGdFJucGFWRmt3U1VkV2RWa3lPV3RoVnpWdVNVaFNiR016VVdkalIwWjZZekpXYTBsUlBUMVJiVVo2V2xSWk1FbEhWblZaTWo="};
@@ -307,7 +376,7 @@ int32_t base64_self_test(void)
     len = sizeof(buffer);
     src = base64_test_enc;
     memset(buffer, 0, len);
-    ret = base64_decode(src, buffer, len);
+    ret = base64_decode(src, strlen(src), buffer, len);
     if (ret <= 0)
     {
         printf("Base64 decoding failed!\n");
@@ -8,7 +8,19 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "codec.h"
+
 int32_t base64_encode(const void *src, size_t srclength, void *dest, size_t targsize);
-int32_t base64_decode(const void *src, void *dest, size_t targsize);
+int32_t base64_decode(const void *src, size_t srclength, void *dest, size_t targsize);
+
+/* Constant-time variants for secrets, see base64_ct.c. */
+int32_t base64_encode_ct(const void *src, size_t srclength, void *dest, size_t targsize);
+int32_t base64_decode_ct(const void *src, size_t srclength, void *dest, size_t targsize);
+
+size_t base64_encode_len(size_t srclength);
+size_t base64_decode_len(size_t srclength);
+
+extern const struct codec_ops base64_ops;
+extern const struct codec_ops base64_ct_ops;
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BASE64_CT_HAVE_SSSE3 1
+#endif
+
+#include "kernel.h"
+#include "base64.h"
+
+/*
+   Constant-time base64 for secret material (keys, tokens).
+
+   The alphabet is mapped arithmetically in both directions: no load is
+   indexed by a data byte and no branch depends on a data byte's value,
+   invalid characters are folded into an error mask that is only tested
+   once at the end.  The input length, and the positions of whitespace,
+   padding and a terminating '\0' are treated as public (they are the
+   layout of a PEM block, not its content) and may steer control flow.
+
+   SSSE3 handles 12 input bytes / 16 characters per step with compare and
+   mask arithmetic; pshufb is only used with constant shuffle controls.
+   The scalar loops cover CPUs without SSSE3, the tails and whitespace.
+ */
+
+static const char base64_ct_pad = '=';
+
+/* 6-bit value to its character, "ABC..Zab..z01..9+/" without a table. */
+static inline uint8_t base64_ct_enc(uint32_t x) {
+    uint32_t diff = 'A';
+
+    diff += ((25 - x) >> 8) & 6;  /* x > 25: 'a' - 26 */
+    diff -= ((51 - x) >> 8) & 75; /* x > 51: '0' - 52 */
+    diff -= ((61 - x) >> 8) & 15; /* x > 61: '+' - 62 */
+    diff += ((62 - x) >> 8) & 3;  /* x > 62: '/' - 63 */
+    return (uint8_t)(x + diff);
+}
+
+/* Character to its 6-bit value, -1 if it is not in the alphabet. */
+static inline int32_t base64_ct_dec(uint8_t c) {
+    int32_t ch = c, ret = -1;
+
+    ret += (((0x40 - ch) & (ch - 0x5b)) >> 8) & (ch - 64); /* 'A'..'Z' */
+    ret += (((0x60 - ch) & (ch - 0x7b)) >> 8) & (ch - 70); /* 'a'..'z' */
+    ret += (((0x2f - ch) & (ch - 0x3a)) >> 8) & (ch + 5);  /* '0'..'9' */
+    ret += (((0x2a - ch) & (ch - 0x2c)) >> 8) & 63;        /* '+' */
+    ret += (((0x2e - ch) & (ch - 0x30)) >> 8) & 64;        /* '/' */
+    return ret;
+}
+
+static inline bool base64_ct_space(uint8_t c) {
+    return (c == ' ') || ((uint8_t)(c - '\t') <= ('\r' - '\t'));
+}
+
+#ifdef BASE64_CT_HAVE_SSSE3
+/* Sixteen 6-bit values to characters, the vector form of base64_ct_enc(). */
+__attribute__((target("ssse3"))) static inline __m128i base64_ct_enc_vec(__m128i idx) {
+    __m128i off = _mm_set1_epi8('A');
+
+    off = _mm_add_epi8(off, _mm_and_si128(_mm_cmpgt_epi8(idx, _mm_set1_epi8(25)), _mm_set1_epi8(6)));
+    off = _mm_sub_epi8(off, _mm_and_si128(_mm_cmpgt_epi8(idx, _mm_set1_epi8(51)), _mm_set1_epi8(75)));
+    off = _mm_sub_epi8(off, _mm_and_si128(_mm_cmpgt_epi8(idx, _mm_set1_epi8(61)), _mm_set1_epi8(15)));
+    off = _mm_add_epi8(off, _mm_and_si128(_mm_cmpgt_epi8(idx, _mm_set1_epi8(62)), _mm_set1_epi8(3)));
+    return _mm_add_epi8(idx, off);
+}
+
+/* Needs 16 readable bytes per 12 consumed, the tail is left to the scalar loop. */
+__attribute__((target("ssse3"))) static size_t base64_ct_encode_ssse3(const uint8_t *src, size_t srclength,
+                                                                       char *dest) {
+    const __m128i shuf = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    size_t done = 0;
+    __m128i in, lo, hi;
+
+    while (srclength - done >= 16) {
+        in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + done)), shuf);
+        /* Move the four 6-bit fields of every 32-bit lane into their own byte. */
+        lo = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        hi = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        _mm_storeu_si128((__m128i *)dest, base64_ct_enc_vec(_mm_or_si128(lo, hi)));
+        done += 12;
+        dest += 16;
+    }
+    return done;
+}
+
+/*
+ * Decodes 16 character blocks while they hold nothing but alphabet
+ * characters (or invalid ones, which only set the error mask) and 16 bytes
+ * of room are left.  Returns the characters consumed.
+ */
+__attribute__((target("ssse3"))) static size_t base64_ct_decode_ssse3(const uint8_t *src, size_t srclength,
+                                                                       uint8_t *dest, size_t room, uint32_t *err) {
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    __m128i errv = _mm_setzero_si128();
+    __m128i c, t, upper, lower, digit, plus, slash, val, stop;
+    size_t done = 0, out = 0;
+
+    while ((srclength - done >= 16) && (room - out >= 16)) {
+        c = _mm_loadu_si128((const __m128i *)(src + done));
+
+        /* Layout only: whitespace, padding or the terminator end the dense run. */
+        t = _mm_sub_epi8(c, _mm_set1_epi8('\t'));
+        stop = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8('\r' - '\t')), t);
+        stop = _mm_or_si128(stop, _mm_cmpeq_epi8(c, _mm_set1_epi8(' ')));
+        stop = _mm_or_si128(stop, _mm_cmpeq_epi8(c, _mm_set1_epi8(base64_ct_pad)));
+        stop = _mm_or_si128(stop, _mm_cmpeq_epi8(c, _mm_setzero_si128()));
+        if (_mm_movemask_epi8(stop) != 0) {
+            break;
+        }
+
+        upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('Z' + 1)));
+        lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('z' + 1)));
+        digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+        slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+
+        val = _mm_and_si128(upper, _mm_sub_epi8(c, _mm_set1_epi8('A')));
+        val = _mm_or_si128(val, _mm_and_si128(lower, _mm_sub_epi8(c, _mm_set1_epi8('a' - 26))));
+        val = _mm_or_si128(val, _mm_and_si128(digit, _mm_add_epi8(c, _mm_set1_epi8(52 - '0'))));
+        val = _mm_or_si128(val, _mm_and_si128(plus, _mm_set1_epi8(62)));
+        val = _mm_or_si128(val, _mm_and_si128(slash, _mm_set1_epi8(63)));
+        t = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+        errv = _mm_or_si128(errv, _mm_andnot_si128(t, _mm_set1_epi8(-1)));
+
+        /* Join four 6-bit values into 24 bits per lane, then drop the empty bytes. */
+        val = _mm_maddubs_epi16(val, _mm_set1_epi32(0x01400140));
+        val = _mm_madd_epi16(val, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128((__m128i *)(dest + out), _mm_shuffle_epi8(val, pack));
+        done += 16;
+        out += 12;
+    }
+    *err |= _mm_movemask_epi8(errv);
+    return done;
+}
+#endif
+
+CODEC_KERNEL int32_t base64_encode_ct(const void *src, size_t srclength, void *dest, size_t targsize) {
+    const uint8_t *_src_ = src;
+    char *target = dest;
+    size_t datalength = 0, done = 0;
+    uint32_t group = 0;
+
+    if (((srclength + 2) / 3) * 4 >= targsize) {
+        return (-1);
+    }
+
+#ifdef BASE64_CT_HAVE_SSSE3
+    if (__builtin_cpu_supports("ssse3")) {
+        done = base64_ct_encode_ssse3(_src_, srclength, target);
+        _src_ += done;
+        srclength -= done;
+        datalength = done / 3 * 4;
+    }
+#endif
+
+    while (2 < srclength) {
+        group = ((uint32_t)_src_[0] << 16) | ((uint32_t)_src_[1] << 8) | _src_[2];
+        _src_ += 3;
+        srclength -= 3;
+
+        target[datalength++] = base64_ct_enc(group >> 18);
+        target[datalength++] = base64_ct_enc((group >> 12) & 0x3F);
+        target[datalength++] = base64_ct_enc((group >> 6) & 0x3F);
+        target[datalength++] = base64_ct_enc(group & 0x3F);
+    }
+
+    /* Now we worry about padding, the length is public. */
+    if (0 != srclength) {
+        group = ((uint32_t)_src_[0] << 16) | ((srclength > 1) ? ((uint32_t)_src_[1] << 8) : 0);
+        target[datalength++] = base64_ct_enc(group >> 18);
+        target[datalength++] = base64_ct_enc((group >> 12) & 0x3F);
+        target[datalength++] = (srclength == 1) ? base64_ct_pad : base64_ct_enc((group >> 6) & 0x3F);
+        target[datalength++] = base64_ct_pad;
+    }
+    target[datalength] = '\0'; /* Returned value doesn't count \0. */
+    return (datalength);
+}
+
+/* Same input rules as base64_decode(): whitespace anywhere, padding required. */
+CODEC_KERNEL int32_t base64_decode_ct(const void *src, size_t srclength, void *dest, size_t targsize) {
+    const uint8_t *_src_ = src;
+    uint8_t *target = dest;
+    size_t i = 0, tarindex = 0, state = 0, pads = 0;
+    uint32_t acc = 0, err = 0;
+    int32_t v = 0;
+    uint8_t c = 0;
+#ifdef BASE64_CT_HAVE_SSSE3
+    bool simd = __builtin_cpu_supports("ssse3");
+    size_t n = 0;
+#endif
+
+    if (target == NULL) {
+        return (-1);
+    }
+
+    while (i < srclength) {
+#ifdef BASE64_CT_HAVE_SSSE3
+        if (simd && (state == 0) && (pads == 0)) {
+            n = base64_ct_decode_ssse3(_src_ + i, srclength - i, target + tarindex, targsize - tarindex, &err);
+            i += n;
+            tarindex += n / 4 * 3;
+            if (i == srclength) {
+                break;
+            }
+        }
+#endif
+        c = _src_[i++];
+        if (c == '\0') {
+            break;
+        }
+        if (base64_ct_space(c)) {
+            continue;
+        }
+        if (c == base64_ct_pad) {
+            pads++;
+            continue;
+        }
+        err |= (pads != 0); /* Data after the padding. */
+
+        v = base64_ct_dec(c);
+        err |= (uint32_t)v >> 31;
+        acc = (acc << 6) | ((uint32_t)v & 0x3F);
+        if (++state == 4) {
+            if (tarindex + 3 > targsize) {
+                return (-1);
+            }
+            target[tarindex++] = (uint8_t)(acc >> 16);
+            target[tarindex++] = (uint8_t)(acc >> 8);
+            target[tarindex++] = (uint8_t)acc;
+            acc = 0;
+            state = 0;
+        }
+    }
+
+    /* Padding completes a group of 2 or 3 characters, whose spare bits must be zero. */
+    switch (state) {
+        case 0:
+            err |= (pads != 0);
+            break;
+        case 2:
+            err |= (pads != 2);
+            err |= ((acc & 0x0F) + 0x0F) >> 4;
+            if (tarindex + 1 > targsize) {
+                return (-1);
+            }
+            target[tarindex++] = (uint8_t)(acc >> 4);
+            break;
+        case 3:
+            err |= (pads != 1);
+            err |= ((acc & 0x03) + 0x03) >> 2;
+            if (tarindex + 2 > targsize) {
+                return (-1);
+            }
+            target[tarindex++] = (uint8_t)(acc >> 10);
+            target[tarindex++] = (uint8_t)(acc >> 2);
+            break;
+        default:
+            err |= 1;
+            break;
+    }
+    if (err != 0) {
+        return (-1);
+    }
+
+    /* Null-terminate if we have room left */
+    if (tarindex < targsize)
+        target[tarindex] = 0;
+
+    return (tarindex);
+}
+
+const struct codec_ops base64_ct_ops = {
+    .name = "Base64-CT",
+    .enc_block = 3,
+    .dec_block = 4,
+    .pad = '=',
+    .encode_len = base64_encode_len,
+    .decode_len = base64_decode_len,
+    .encode = base64_encode_ct,
+    .decode = base64_decode_ct,
+    .ct = &base64_ct_ops,
+};
@@ -0,0 +1,6 @@
+#include "codec.h"
+#include "base64.h"
+
+int main(int argc, char **argv) {
+    return codec_main(&base64_ops, argc, argv);
+}
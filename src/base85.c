@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "kernel.h"
+#include "base85.h"
+
+/*
+   Base85 represents 32-bit groups of input bits, most significant byte
+   first, as 5 digits in base 85.  Two alphabets are supported:
+
+   Ascii85 (btoa, PostScript, PDF) uses the characters '!' (0) to 'u' (84)
+   and writes an all-zero group as the single character 'z'.  A final group
+   of 1..3 bytes is padded with zeros, encoded and truncated to n + 1
+   characters; the decoder pads the missing characters with 'u'.  The <~ ~>
+   delimiters used by PostScript are not written and not accepted.
+
+   Z85 (ZeroMQ RFC 32) uses an alphabet that is safe inside source code
+   string literals and has no short forms.  The input length has to be a
+   multiple of 4 bytes, the encoded length a multiple of 5 characters.
+ */
+
+#define BASE85_LEN 85
+static const char ascii85_enc_map[BASE85_LEN + 1] = {"!\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                                      "[\\]^_`abcdefghijklmnopqrstu"};
+static const char z85_enc_map[BASE85_LEN + 1] = {"0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                                  ".-:+=^!/*?&<>()[]{}@%$#"};
+static const char ascii85_enc_zero = 'z';
+
+/* Decode table values besides 0..84. */
+#define BASE85_DEC_SPACE (0xFE)
+#define BASE85_DEC_INVALID (0xFF)
+
+static uint8_t ascii85_dec_map[256];
+static uint8_t z85_dec_map[256];
+
+static void base85_build_dec_map(uint8_t *map, const char *alphabet) {
+    int32_t i = 0;
+
+    memset(map, BASE85_DEC_INVALID, 256);
+    for (i = 0; i < 256; i++) {
+        if (isspace(i)) {
+            map[i] = BASE85_DEC_SPACE;
+        }
+    }
+    for (i = 0; i < BASE85_LEN; i++) {
+        map[(uint8_t)alphabet[i]] = i;
+    }
+}
+
+__attribute__((constructor)) static void base85_init(void) {
+    base85_build_dec_map(ascii85_dec_map, ascii85_enc_map);
+    base85_build_dec_map(z85_dec_map, z85_enc_map);
+}
+
+static inline void base85_put_group(char *target, uint32_t value, const char *alphabet) {
+    int32_t i = 0;
+
+    for (i = 4; i >= 0; i--) {
+        target[i] = alphabet[value % BASE85_LEN];
+        value /= BASE85_LEN;
+    }
+}
+
+CODEC_KERNEL static int32_t base85_encode(const void *src, size_t srclength, void *dest, size_t targsize,
+                                          const char *alphabet, bool short_zero) {
+    const uint8_t *_src_ = src;
+    char *target = dest;
+    size_t datalength = 0, i = 0;
+    uint32_t value = 0;
+    char group[5] = {0};
+
+    if (((srclength + 3) / 4) * 5 >= targsize) {
+        return (-1);
+    }
+
+    while (3 < srclength) {
+        value = ((uint32_t)_src_[0] << 24) | ((uint32_t)_src_[1] << 16) | ((uint32_t)_src_[2] << 8) | _src_[3];
+        _src_ += 4;
+        srclength -= 4;
+
+        if (short_zero && value == 0) {
+            target[datalength++] = ascii85_enc_zero;
+            continue;
+        }
+        base85_put_group(target + datalength, value, alphabet);
+        datalength += 5;
+    }
+
+    /* Partial final group, n bytes give n + 1 characters. */
+    if (0 != srclength) {
+        value = 0;
+        for (i = 0; i < 4; i++) {
+            value = (value << 8) | (i < srclength ? _src_[i] : 0);
+        }
+        base85_put_group(group, value, alphabet);
+        memcpy(target + datalength, group, srclength + 1);
+        datalength += srclength + 1;
+    }
+    target[datalength] = '\0'; /* Returned value doesn't count \0. */
+    return (datalength);
+}
+
+CODEC_KERNEL static int32_t base85_decode(const void *src, size_t srclength, void *dest, size_t targsize,
+                                          const uint8_t *dec_map, bool short_zero) {
+    const uint8_t *_src_ = src;
+    uint8_t *target = dest;
+    size_t tarindex = 0, i = 0, j = 0, state = 0;
+    uint64_t value = 0;
+    uint8_t v = 0;
+
+    for (i = 0; i < srclength && _src_[i] != '\0'; i++) {
+        v = dec_map[_src_[i]];
+        if (v == BASE85_DEC_SPACE) {
+            continue;
+        }
+        if (short_zero && state == 0 && _src_[i] == ascii85_enc_zero) {
+            if (tarindex + 4 > targsize)
+                return (-1);
+            memset(target + tarindex, 0, 4);
+            tarindex += 4;
+            continue;
+        }
+        if (v == BASE85_DEC_INVALID) /* A non-base85 character. */
+            return (-1);
+
+        value = value * BASE85_LEN + v;
+        if (++state == 5) {
+            if (value > UINT32_MAX) /* Group overflows 32 bits. */
+                return (-1);
+            if (tarindex + 4 > targsize)
+                return (-1);
+            for (j = 0; j < 4; j++) {
+                target[tarindex++] = (uint8_t)(value >> (24 - j * 8));
+            }
+            value = 0;
+            state = 0;
+        }
+    }
+
+    /* A single trailing character can't come from a whole byte. */
+    if (state == 1)
+        return (-1);
+    if (state != 0) {
+        for (j = state; j < 5; j++) {
+            value = value * BASE85_LEN + (BASE85_LEN - 1);
+        }
+        if (value > UINT32_MAX)
+            return (-1);
+        if (tarindex + state - 1 > targsize)
+            return (-1);
+        for (j = 0; j < state - 1; j++) {
+            target[tarindex++] = (uint8_t)(value >> (24 - j * 8));
+        }
+    }
+
+    /* Null-terminate if we have room left */
+    if (tarindex < targsize)
+        target[tarindex] = 0;
+
+    return (tarindex);
+}
+
+int32_t ascii85_encode(const void *src, size_t srclength, void *dest, size_t targsize) {
+    return base85_encode(src, srclength, dest, targsize, ascii85_enc_map, true);
+}
+
+int32_t ascii85_decode(const void *src, size_t srclength, void *dest, size_t targsize) {
+    return base85_decode(src, srclength, dest, targsize, ascii85_dec_map, true);
+}
+
+int32_t z85_encode(const void *src, size_t srclength, void *dest, size_t targsize) {
+    if (srclength % 4 != 0) {
+        return (-1);
+    }
+    return base85_encode(src, srclength, dest, targsize, z85_enc_map, false);
+}
+
+int32_t z85_decode(const void *src, size_t srclength, void *dest, size_t targsize) {
+    size_t i = 0, chars = 0;
+
+    for (i = 0; i < srclength && ((const uint8_t *)src)[i] != '\0'; i++) {
+        if (z85_dec_map[((const uint8_t *)src)[i]] != BASE85_DEC_SPACE) {
+            chars++;
+        }
+    }
+    if (chars % 5 != 0) {
+        return (-1);
+    }
+    return base85_decode(src, srclength, dest, targsize, z85_dec_map, false);
+}
+
+size_t ascii85_encode_len(size_t srclength) {
+    return ((srclength + 3) / 4) * 5 + 1;
+}
+
+size_t ascii85_decode_len(size_t srclength) {
+    /* Every 'z' expands to 4 bytes. */
+    return srclength * 4 + 1;
+}
+
+size_t z85_decode_len(size_t srclength) {
+    return (srclength / 5) * 4 + 1;
+}
+
+/* 'z' is a complete group on its own. */
+static size_t ascii85_dec_split(const char *src, size_t srclength) {
+    size_t i = 0;
+
+    while (i < srclength) {
+        if (src[i] == ascii85_enc_zero) {
+            i++;
+        } else if (srclength - i >= 5) {
+            i += 5;
+        } else {
+            break;
+        }
+    }
+    return i;
+}
+
+const struct codec_ops ascii85_ops = {
+    .name = "Ascii85",
+    .enc_block = 4,
+    .dec_block = 5,
+    .encode_len = ascii85_encode_len,
+    .decode_len = ascii85_decode_len,
+    .encode = ascii85_encode,
+    .decode = ascii85_decode,
+    .dec_split = ascii85_dec_split,
+    .enc_var = true,
+};
+
+const struct codec_ops z85_ops = {
+    .name = "Z85",
+    .enc_block = 4,
+    .dec_block = 5,
+    .encode_len = ascii85_encode_len,
+    .decode_len = z85_decode_len,
+    .encode = z85_encode,
+    .decode = z85_decode,
+};
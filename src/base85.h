@@ -0,0 +1,25 @@
+#ifndef __BASE85_H__
+#define __BASE85_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "codec.h"
+
+int32_t ascii85_encode(const void *src, size_t srclength, void *dest, size_t targsize);
+int32_t ascii85_decode(const void *src, size_t srclength, void *dest, size_t targsize);
+int32_t z85_encode(const void *src, size_t srclength, void *dest, size_t targsize);
+int32_t z85_decode(const void *src, size_t srclength, void *dest, size_t targsize);
+
+size_t ascii85_encode_len(size_t srclength);
+size_t ascii85_decode_len(size_t srclength);
+size_t z85_decode_len(size_t srclength);
+
+extern const struct codec_ops ascii85_ops;
+extern const struct codec_ops z85_ops;
+
+#endif
@@ -0,0 +1,6 @@
+#include "codec.h"
+#include "base85.h"
+
+int main(int argc, char **argv) {
+    return codec_main(&ascii85_ops, argc, argv);
+}
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "compact.h"
+#include "daemon.h"
+#include "blockidx.h"
+
+static int64_t codec_index_mtime(const struct stat *st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static size_t codec_index_skip(const uint8_t *map, size_t size, size_t pos) {
+    while ((pos < size) && isspace(map[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+/* Encoded offset of block b, the file size for the block after the last. */
+static uint64_t codec_index_off(const struct codec_index *idx, uint64_t b) {
+    if (b >= idx->hdr.count) {
+        return idx->hdr.enc_size;
+    }
+    return idx->hdr.dense ? b * idx->hdr.chars : idx->offs[b];
+}
+
+/*
+ * Block offsets must rise strictly and stay inside the encoded file, and the
+ * decoded size must fit the block count, or pread would compute slices that
+ * underflow.
+ */
+static int32_t codec_index_valid(const struct codec_index *idx) {
+    const struct codec_index_hdr *hdr = &idx->hdr;
+    uint64_t b = 0;
+
+    if (hdr->count == 0) {
+        return (hdr->dec_size == 0) ? 0 : -1;
+    }
+    if ((hdr->dec_size <= (hdr->count - 1) * hdr->block) || (hdr->dec_size > hdr->count * hdr->block)) {
+        return -1;
+    }
+    if (codec_index_off(idx, hdr->count - 1) >= hdr->enc_size) {
+        return -1;
+    }
+    for (b = 1; !hdr->dense && (b < hdr->count); b++) {
+        if (idx->offs[b] <= idx->offs[b - 1]) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int32_t codec_index_read(int fd, uint8_t *buf, size_t len, off_t offset) {
+    ssize_t n = 0;
+
+    while (len > 0) {
+        n = pread(fd, buf, len, offset);
+        if ((n < 0) && (errno == EINTR)) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+int32_t codec_index_build(const struct codec_ops *ops, int fd, struct codec_index *idx) {
+    struct codec_index_hdr *hdr = &idx->hdr;
+    struct stat st;
+    uint8_t *map = MAP_FAILED, *out = NULL, *in = NULL;
+    uint64_t *offs = NULL;
+    size_t size = 0, pos = 0, need = 0, step = 0, n = 0, cap = 0, last = 0, inlen = 0;
+    int32_t id = codec_id_of(ops), ret = -1, len = 0;
+
+    memset(idx, 0, sizeof(*idx));
+    idx->ops = ops;
+    if ((id < 0) || (ops->dec_split != NULL)) {
+        PRINT_ERROR("%s input can't be indexed!", ops->name);
+        return -1;
+    }
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+        return -1;
+    }
+    size = st.st_size;
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    hdr->magic = CODEC_INDEX_MAGIC;
+    hdr->version = CODEC_INDEX_VERSION;
+    hdr->codec = id & ~CODEC_ID_CT; /* Both variants decode the same index. */
+    hdr->block = ops->enc_block * CODEC_INDEX_GROUPS;
+    hdr->chars = ops->dec_block * CODEC_INDEX_GROUPS;
+    hdr->enc_size = size;
+    hdr->enc_mtime = codec_index_mtime(&st);
+    hdr->dense = (codec_space_count(map, size) == 0);
+
+    /* Step over chars non-whitespace characters per block, counting whitespace a window at a time. */
+    for (pos = codec_index_skip(map, size, 0); pos < size; pos = codec_index_skip(map, size, pos)) {
+        if (!hdr->dense) {
+            if (hdr->count == cap) {
+                cap = (cap > 0) ? cap * 2 : 1024;
+                offs = realloc(idx->offs, cap * sizeof(*offs));
+                if (offs == NULL) {
+                    goto err;
+                }
+                idx->offs = offs;
+            }
+            idx->offs[hdr->count] = pos;
+        }
+        hdr->count++;
+        for (need = hdr->chars; (need > 0) && (pos < size); need -= n) {
+            step = (size - pos < need) ? size - pos : need;
+            n = step - codec_space_count(map + pos, step);
+            pos += step;
+        }
+    }
+
+    /* Every block but the last decodes to exactly block bytes. */
+    if (hdr->count > 0) {
+        last = codec_index_off(idx, hdr->count - 1);
+        in = malloc(size - last);
+        out = malloc(ops->decode_len(size - last));
+        if ((in == NULL) || (out == NULL)) {
+            goto err;
+        }
+        /* Not every decoder skips whitespace. */
+        inlen = codec_space_strip(in, size - last, map + last, size - last);
+        len = ops->decode(in, inlen, out, ops->decode_len(size - last));
+        if (len < 0) {
+            PRINT_ERROR("%s decode of the last block failed!", ops->name);
+            goto err;
+        }
+        hdr->dec_size = (hdr->count - 1) * hdr->block + len;
+    }
+    ret = 0;
+err:
+    free(in);
+    free(out);
+    munmap(map, size);
+    if (ret != 0) {
+        codec_index_free(idx);
+    }
+    return ret;
+}
+
+int32_t codec_index_save(const struct codec_index *idx, const char *path) {
+    FILE *fp = fopen(path, "wb");
+    int32_t ret = -1;
+
+    if (fp == NULL) {
+        return -1;
+    }
+    if ((fwrite(&idx->hdr, sizeof(idx->hdr), 1, fp) == 1) &&
+        (idx->hdr.dense || (fwrite(idx->offs, sizeof(*idx->offs), idx->hdr.count, fp) == idx->hdr.count))) {
+        ret = 0;
+    }
+    if (fclose(fp) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+int32_t codec_index_load(const struct codec_ops *ops, int fd, const char *path, struct codec_index *idx) {
+    struct codec_index_hdr *hdr = &idx->hdr;
+    struct stat st;
+    FILE *fp = NULL;
+    int32_t ret = -1;
+
+    memset(idx, 0, sizeof(*idx));
+    idx->ops = ops;
+    if (fstat(fd, &st) != 0) {
+        return -1;
+    }
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return -1;
+    }
+    if (fread(hdr, sizeof(*hdr), 1, fp) != 1) {
+        goto err;
+    }
+    if ((hdr->magic != CODEC_INDEX_MAGIC) || (hdr->version != CODEC_INDEX_VERSION) ||
+        (hdr->codec != (codec_id_of(ops) & ~CODEC_ID_CT)) || (hdr->chars != ops->dec_block * CODEC_INDEX_GROUPS) ||
+        (hdr->block != ops->enc_block * CODEC_INDEX_GROUPS) || (hdr->count > hdr->enc_size / hdr->chars + 1)) {
+        PRINT_ERROR("[%s] is not a %s index!", path, ops->name);
+        goto err;
+    }
+    if ((hdr->enc_size != (uint64_t)st.st_size) || (hdr->enc_mtime != codec_index_mtime(&st))) {
+        PRINT_ERROR("Index [%s] is stale!", path);
+        goto err;
+    }
+    if (!hdr->dense) {
+        idx->offs = malloc(hdr->count * sizeof(*idx->offs));
+        if ((idx->offs == NULL) || (fread(idx->offs, sizeof(*idx->offs), hdr->count, fp) != hdr->count)) {
+            goto err;
+        }
+    }
+    if (codec_index_valid(idx) != 0) {
+        PRINT_ERROR("Index [%s] is corrupt, treating it as stale!", path);
+        goto err;
+    }
+    ret = 0;
+err:
+    fclose(fp);
+    if (ret != 0) {
+        codec_index_free(idx);
+    }
+    return ret;
+}
+
+void codec_index_free(struct codec_index *idx) {
+    free(idx->offs);
+    idx->offs = NULL;
+}
+
+int32_t codec_index_pread(const struct codec_index *idx, int fd, void *dest, size_t *len, uint64_t start) {
+    const struct codec_ops *ops = idx->ops;
+    const struct codec_index_hdr *hdr = &idx->hdr;
+    uint64_t b = 0, b0 = 0, b1 = 0, off = 0, skip = 0;
+    size_t slice = 0, maxin = 0, outsize = 0, take = 0, done = 0;
+    uint8_t *in = NULL, *out = NULL;
+    int32_t n = 0, ret = -1;
+
+    if (start >= hdr->dec_size) {
+        return -1;
+    }
+    if (*len > hdr->dec_size - start) {
+        *len = hdr->dec_size - start;
+    }
+    if (*len == 0) {
+        return 0;
+    }
+    b0 = start / hdr->block;
+    b1 = (start + *len - 1) / hdr->block;
+    for (b = b0; b <= b1; b++) {
+        slice = codec_index_off(idx, b + 1) - codec_index_off(idx, b);
+        maxin = (slice > maxin) ? slice : maxin;
+    }
+    outsize = ops->decode_len(maxin);
+    in = malloc(maxin);
+    out = malloc(outsize);
+    if ((in == NULL) || (out == NULL)) {
+        goto err;
+    }
+
+    for (b = b0; b <= b1; b++) {
+        off = codec_index_off(idx, b);
+        slice = codec_index_off(idx, b + 1) - off;
+        if (codec_index_read(fd, in, slice, off) != 0) {
+            PRINT_ERROR("Failed to read block [%lu]!", (unsigned long)b);
+            goto err;
+        }
+        slice = codec_space_strip(in, slice, in, slice);
+        n = ops->decode(in, slice, out, outsize);
+        skip = (b == b0) ? start - b0 * hdr->block : 0;
+        if ((n < 0) || ((b + 1 < hdr->count) && ((uint32_t)n != hdr->block)) || ((uint64_t)n < skip)) {
+            PRINT_ERROR("%s decode of block [%lu] failed!", ops->name, (unsigned long)b);
+            goto err;
+        }
+        take = ((n - skip) < (*len - done)) ? n - skip : *len - done;
+        memcpy((uint8_t *)dest + done, out + skip, take);
+        done += take;
+    }
+    *len = done;
+    ret = 0;
+err:
+    free(in);
+    free(out);
+    return ret;
+}
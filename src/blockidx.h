@@ -0,0 +1,62 @@
+#ifndef __BLOCKIDX_H__
+#define __BLOCKIDX_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "codec.h"
+
+/*
+ * Sidecar block index for random access into an encoded file.  Entry k is
+ * the encoded file offset of the group that decodes to byte k * block, so
+ * a decoded range only needs the blocks that cover it read and decoded.
+ * Input without any whitespace is marked dense and stores no entries, the
+ * offsets follow from the block size.
+ *
+ * The index records the encoded file's size and mtime and is refused once
+ * either changed.  Codecs with variable sized groups (Ascii85) can't be
+ * indexed.
+ */
+#define CODEC_INDEX_MAGIC (0x58494443) /* "CDIX" */
+#define CODEC_INDEX_VERSION (1)
+#define CODEC_INDEX_GROUPS (16384) /* Encoded groups per block. */
+
+struct codec_index_hdr {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t codec; /* enum codec_id */
+    uint8_t dense;
+    uint8_t reserved;
+    uint32_t block; /* Decoded bytes per entry. */
+    uint32_t chars; /* Non-whitespace characters per entry. */
+    uint64_t enc_size;
+    int64_t enc_mtime; /* Nanoseconds. */
+    uint64_t dec_size;
+    uint64_t count; /* Blocks, entries that follow unless dense. */
+};
+
+struct codec_index {
+    const struct codec_ops *ops;
+    struct codec_index_hdr hdr;
+    uint64_t *offs;
+};
+
+/* Scans the encoded file fd, counting whitespace only, nothing is decoded except the last block. */
+int32_t codec_index_build(const struct codec_ops *ops, int fd, struct codec_index *idx);
+int32_t codec_index_save(const struct codec_index *idx, const char *path);
+/* -1 if path is missing, not an index for ops or stale for fd. */
+int32_t codec_index_load(const struct codec_ops *ops, int fd, const char *path, struct codec_index *idx);
+void codec_index_free(struct codec_index *idx);
+
+/*
+ * Decodes *len bytes starting at decoded offset start into dest.  *len is
+ * clipped to the end of the payload; -1 if start is past it.  Whitespace is
+ * stripped from every block before ops->decode sees it.
+ */
+int32_t codec_index_pread(const struct codec_index *idx, int fd, void *dest, size_t *len, uint64_t start);
+
+#endif
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "buffer.h"
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED (1)
+#endif
+
+static size_t codec_buf_page(void) {
+    static size_t page = 0;
+
+    if (page == 0) {
+        page = sysconf(_SC_PAGESIZE);
+    }
+    return page;
+}
+
+static bool codec_buf_is_huge(size_t len) {
+    return len >= CODEC_HUGE_PAGE;
+}
+
+/* Length of the mapping behind a buffer of len bytes. */
+static size_t codec_buf_size(size_t len) {
+    size_t align = codec_buf_is_huge(len) ? CODEC_HUGE_PAGE : codec_buf_page();
+
+    return (len + align - 1) & ~(align - 1);
+}
+
+void *codec_buf_alloc(size_t len) {
+    size_t size = codec_buf_size(len);
+    size_t head = 0;
+    uint8_t *map = NULL;
+
+    if (len == 0) {
+        return NULL;
+    }
+
+    if (!codec_buf_is_huge(len)) {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return (map == MAP_FAILED) ? NULL : map;
+    }
+
+#ifdef MAP_HUGETLB
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (map != MAP_FAILED) {
+        return map;
+    }
+#endif
+
+    /* No reserved huge pages, over-map and trim to a huge page boundary for THP. */
+    map = mmap(NULL, size + CODEC_HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    head = (CODEC_HUGE_PAGE - ((uintptr_t)map & (CODEC_HUGE_PAGE - 1))) & (CODEC_HUGE_PAGE - 1);
+    if (head > 0) {
+        munmap(map, head);
+    }
+    munmap(map + head + size, CODEC_HUGE_PAGE - head);
+    map += head;
+#ifdef MADV_HUGEPAGE
+    madvise(map, size, MADV_HUGEPAGE);
+#endif
+    return map;
+}
+
+void codec_buf_free(void *buf, size_t len) {
+    if (buf != NULL) {
+        munmap(buf, codec_buf_size(len));
+    }
+}
+
+int32_t codec_buf_nodes(void) {
+    static int32_t nodes = 0;
+    FILE *fp = NULL;
+    int32_t first = 0, last = 0, count = 0;
+    char sep = 0;
+
+    if (nodes > 0) {
+        return nodes;
+    }
+
+    /* "0", "0-1" or "0,2-3". */
+    fp = fopen("/sys/devices/system/node/online", "r");
+    if (fp != NULL) {
+        while (fscanf(fp, "%d", &first) == 1) {
+            last = first;
+            if ((fscanf(fp, "%c", &sep) == 1) && (sep == '-')) {
+                if (fscanf(fp, "%d", &last) != 1) {
+                    break;
+                }
+                fscanf(fp, "%c", &sep);
+            }
+            count += last - first + 1;
+            if (sep != ',') {
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    nodes = (count > 0) ? count : 1;
+    return nodes;
+}
+
+int32_t codec_buf_node(void) {
+    unsigned cpu = 0, node = 0;
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+        return 0;
+    }
+    return node;
+}
+
+int32_t codec_buf_bind(void *addr, size_t len, int32_t node) {
+    unsigned long mask = 0;
+    uintptr_t start = (uintptr_t)addr & ~(codec_buf_page() - 1);
+
+    if ((codec_buf_nodes() < 2) || (node < 0) || (node >= (int32_t)(sizeof(mask) * 8))) {
+        return 0;
+    }
+    mask = 1UL << node;
+    len += (uintptr_t)addr - start;
+    /* Preferred rather than strict so a full node falls back instead of failing the job. */
+    if (syscall(SYS_mbind, start, len, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0) != 0) {
+        return -1;
+    }
+    return 0;
+}
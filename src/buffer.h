@@ -0,0 +1,30 @@
+#ifndef __BUFFER_H__
+#define __BUFFER_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CODEC_HUGE_PAGE (2UL * 1024 * 1024)
+
+/*
+ * Anonymous mappings for the codec pipeline.  Buffers of CODEC_HUGE_PAGE or
+ * more come from MAP_HUGETLB when the system has huge pages reserved and are
+ * otherwise aligned to CODEC_HUGE_PAGE and marked for transparent huge pages.
+ * Memory is zero filled by the kernel on first touch, never by memset, so
+ * pages land on the node of the thread that writes them first.
+ */
+void *codec_buf_alloc(size_t len);
+void codec_buf_free(void *buf, size_t len);
+
+/* Number of NUMA nodes online and the node of the calling thread. */
+int32_t codec_buf_nodes(void);
+int32_t codec_buf_node(void);
+
+/* Prefer node for the not yet touched pages of [addr, addr + len). */
+int32_t codec_buf_bind(void *addr, size_t len, int32_t node);
+
+#endif
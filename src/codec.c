@@ -0,0 +1,984 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <time.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "codec.h"
+#include "buffer.h"
+#include "compact.h"
+#include "parallel.h"
+#include "daemon.h"
+#include "shmring.h"
+#include "pipeline.h"
+#include "blockidx.h"
+#include "kernel.h"
+#include "output.h"
+
+/* Long only options. */
+#define CODEC_OPT_GZIP (0x100)
+#define CODEC_OPT_ZSTD (0x101)
+#define CODEC_OPT_INDEX (0x102)
+#define CODEC_OPT_RANGE (0x103)
+#define CODEC_OPT_CT (0x104)
+
+int read_file(const char *file, uint8_t **fbuff, size_t *pflen) {
+    int ret = 0;
+    FILE *fp = NULL;
+    uint8_t *pbuff = NULL;
+    long fsize = 0;
+    size_t rsize = 0, len = 0;
+
+    if ((file == NULL) || (fbuff == NULL) || (pflen == NULL)) {
+        ret = -1;
+        goto err;
+    }
+
+    fp = fopen(file, "rb");
+    if (fp == NULL) {
+        ret = -1;
+        goto err;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    fsize = ftell(fp);
+    if (fsize <= 0) {
+        ret = -1;
+        goto err;
+    }
+    fseek(fp, 0, SEEK_SET);
+
+    /* One extra byte so text input is always '\0' terminated. */
+    pbuff = malloc(fsize + 1);
+    if (pbuff == NULL) {
+        ret = -1;
+        goto err;
+    }
+
+    while (len < fsize) {
+        rsize = fread(pbuff + len, 1, fsize - len, fp);
+        if (rsize == 0) {
+            if (ferror(fp) && (errno == EINTR || errno == EAGAIN)) {
+                clearerr(fp);
+                errno = 0;
+                continue;
+            }
+            break;
+        }
+        len += rsize;
+    }
+
+    if (len != fsize) {
+        ret = -1;
+        goto err;
+    }
+    pbuff[len] = '\0';
+
+    *fbuff = pbuff;
+    *pflen = len;
+    ret = 0;
+err:
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    if ((ret != 0) && (pbuff != NULL)) {
+        free(pbuff);
+    }
+    return ret;
+}
+
+int write_file(const char *file, const uint8_t *fbuff, size_t flen) {
+    int ret = 0;
+    int fd = -1;
+    if ((file == NULL) || (fbuff == NULL) || (flen == 0)) {
+        ret = -1;
+        goto err;
+    }
+    fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        ret = -1;
+        goto err;
+    }
+    /* file may be a named pipe, fbuff is only read. */
+    if (codec_out_write(fd, fbuff, flen, false, false) != 0) {
+        ret = -1;
+        goto err;
+    }
+    ret = 0;
+err:
+    if ((fd >= 0) && (close(fd) != 0)) {
+        ret = -1;
+    }
+    return ret;
+}
+
+void codec_stream_init(struct codec_stream *ctx, const struct codec_ops *ops, bool is_decode) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->ops = ops;
+    ctx->is_decode = is_decode;
+}
+
+size_t codec_stream_bound(const struct codec_stream *ctx, size_t srclength) {
+    if (ctx->is_decode) {
+        return ctx->ops->decode_len(srclength + ctx->carry_len);
+    }
+    return ctx->ops->encode_len(srclength + ctx->carry_len);
+}
+
+static int32_t codec_stream_encode(struct codec_stream *ctx, const uint8_t *src, size_t srclength, uint8_t *dest,
+                                   size_t targsize) {
+    const struct codec_ops *ops = ctx->ops;
+    size_t total = 0, full = 0;
+    int32_t ret = 0;
+
+    /* Complete the group left over by the previous update first. */
+    while ((ctx->carry_len > 0) && (ctx->carry_len < ops->enc_block) && (ctx->carry_len < CODEC_STREAM_CARRY) &&
+           (srclength > 0)) {
+        ctx->carry[ctx->carry_len++] = *src++;
+        srclength--;
+    }
+    if (ctx->carry_len == ops->enc_block) {
+        ret = ops->encode(ctx->carry, ctx->carry_len, dest, targsize);
+        if (ret < 0) {
+            return -1;
+        }
+        total += ret;
+        ctx->carry_len = 0;
+    }
+
+    full = srclength - srclength % ops->enc_block;
+    if (full > 0) {
+        ret = ops->encode(src, full, dest + total, targsize - total);
+        if (ret < 0) {
+            return -1;
+        }
+        total += ret;
+    }
+
+    memcpy(ctx->carry + ctx->carry_len, src + full, srclength - full);
+    ctx->carry_len += srclength - full;
+    return total;
+}
+
+static int32_t codec_stream_decode(struct codec_stream *ctx, const uint8_t *src, size_t srclength, uint8_t *dest,
+                                   size_t targsize) {
+    const struct codec_ops *ops = ctx->ops;
+    uint8_t buf[CODEC_STREAM_CARRY + CODEC_STREAM_BLOCK];
+    size_t total = 0, len = 0, split = 0, i = 0, take = 0;
+    int32_t ret = 0;
+
+    while (i < srclength) {
+        memcpy(buf, ctx->carry, ctx->carry_len);
+        len = ctx->carry_len;
+        take = (srclength - i < sizeof(buf) - len) ? srclength - i : sizeof(buf) - len;
+        len += codec_space_strip(buf + len, sizeof(buf) - len, src + i, take);
+        i += take;
+        if (ctx->done && (len > 0)) {
+            return -1;
+        }
+
+        split = (ops->dec_split != NULL) ? ops->dec_split((const char *)buf, len) : len - len % ops->dec_block;
+        if (split > 0) {
+            ret = ops->decode(buf, split, dest + total, targsize - total);
+            if (ret < 0) {
+                return -1;
+            }
+            total += ret;
+            if ((ops->pad != '\0') && (buf[split - 1] == ops->pad)) {
+                ctx->done = true;
+            }
+        }
+
+        ctx->carry_len = len - split;
+        memcpy(ctx->carry, buf + split, ctx->carry_len);
+    }
+    return total;
+}
+
+int32_t codec_stream_update(struct codec_stream *ctx, const void *src, size_t srclength, void *dest, size_t targsize) {
+    if (ctx->is_decode) {
+        return codec_stream_decode(ctx, src, srclength, dest, targsize);
+    }
+    return codec_stream_encode(ctx, src, srclength, dest, targsize);
+}
+
+int32_t codec_stream_final(struct codec_stream *ctx, void *dest, size_t targsize) {
+    int32_t ret = 0;
+
+    if (ctx->carry_len > 0) {
+        if (ctx->is_decode && ctx->done) {
+            return -1;
+        }
+        if (ctx->is_decode) {
+            ret = ctx->ops->decode(ctx->carry, ctx->carry_len, dest, targsize);
+        } else {
+            ret = ctx->ops->encode(ctx->carry, ctx->carry_len, dest, targsize);
+        }
+        ctx->carry_len = 0;
+    }
+    return ret;
+}
+
+static double codec_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void codec_bench_report(const struct codec_ops *ops, const char *path, bool is_decode, uint32_t count,
+                               size_t inlen, double secs) {
+    printf("%-8s %-6s %-7s %u x %zu bytes, %.3f ms, %.2f MB/s\r\n", ops->name, is_decode ? "decode" : "encode", path,
+           count, inlen, secs * 1e3, secs > 0 ? (double)inlen * count / secs / 1e6 : 0.0);
+}
+
+static void codec_print_build(const struct codec_ops *ops) {
+    printf("%s kernels [%s], running [%s], build [%s]\r\n", ops->name, codec_kernel_variants(), codec_kernel_active(),
+           codec_build_opts());
+}
+
+/*
+ * Runs the one-shot and the streaming path count times over the input and
+ * reports the throughput of both, measured on the input side.
+ */
+static int32_t codec_bench(const struct codec_ops *ops, bool is_decode, uint32_t count, const uint8_t *input,
+                           size_t inlen, uint8_t *outbuf, size_t outlen) {
+    struct codec_stream ctx;
+    size_t off = 0, chunk = 0, total = 0;
+    double start = 0;
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    codec_print_build(ops);
+    start = codec_now();
+    for (i = 0; i < count; i++) {
+        ret = is_decode ? ops->decode(input, inlen, outbuf, outlen) : ops->encode(input, inlen, outbuf, outlen);
+        if (ret < 0) {
+            return -1;
+        }
+    }
+    codec_bench_report(ops, "oneshot", is_decode, count, inlen, codec_now() - start);
+
+    start = codec_now();
+    for (i = 0; i < count; i++) {
+        codec_stream_init(&ctx, ops, is_decode);
+        for (off = 0, total = 0; off < inlen; off += chunk) {
+            chunk = (inlen - off < CODEC_STREAM_BLOCK) ? inlen - off : CODEC_STREAM_BLOCK;
+            ret = codec_stream_update(&ctx, input + off, chunk, outbuf + total, outlen - total);
+            if (ret < 0) {
+                return -1;
+            }
+            total += ret;
+        }
+        if (codec_stream_final(&ctx, outbuf + total, outlen - total) < 0) {
+            return -1;
+        }
+    }
+    codec_bench_report(ops, "stream", is_decode, count, inlen, codec_now() - start);
+    return 0;
+}
+
+#define CODEC_LEAK_LEN (1024)
+#define CODEC_LEAK_INPUTS (256)
+#define CODEC_LEAK_SAMPLES (20000)
+#define CODEC_LEAK_T_MAX (4.5)
+
+static uint64_t codec_leak_rand(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int codec_leak_cmp(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * Timing variance test in the style of dudect: times single calls on a
+ * fixed input (all zero bytes) and on random inputs of the same length,
+ * interleaved in random order, drops samples above the 90th percentile and
+ * compares the two classes with Welch's t-test.  |t| above
+ * CODEC_LEAK_T_MAX means the run time depends on the data.
+ */
+static int32_t codec_bench_leak(const struct codec_ops *ops, bool is_decode) {
+    size_t enclen = ops->encode_len(CODEC_LEAK_LEN), outlen = 0, inlen = 0, i = 0, k = 0;
+    size_t stride = is_decode ? enclen : CODEC_LEAK_LEN;
+    uint8_t *inputs = NULL, *work = NULL, *raw = NULL, *out = NULL, *cls = NULL;
+    double *times = NULL, *sorted = NULL, crop = 0, start = 0, mean[2] = {0}, m2[2] = {0}, d = 0, t = 0;
+    uint64_t seed = 0x9e3779b97f4a7c15ULL, n[2] = {0};
+    int32_t ret = -1, len = 0;
+
+    outlen = is_decode ? ops->decode_len(enclen) : enclen;
+    inputs = malloc((CODEC_LEAK_INPUTS + 1) * stride);
+    work = malloc(stride);
+    raw = malloc(CODEC_LEAK_LEN);
+    out = malloc(outlen);
+    cls = malloc(CODEC_LEAK_SAMPLES);
+    times = malloc(CODEC_LEAK_SAMPLES * sizeof(*times));
+    sorted = malloc(CODEC_LEAK_SAMPLES * sizeof(*sorted));
+    if ((inputs == NULL) || (work == NULL) || (raw == NULL) || (out == NULL) || (cls == NULL) || (times == NULL) ||
+        (sorted == NULL)) {
+        goto err;
+    }
+
+    /* Slot 0 is the fixed class, decode inputs are the encodings. */
+    for (k = 0; k <= CODEC_LEAK_INPUTS; k++) {
+        for (i = 0; i < CODEC_LEAK_LEN; i++) {
+            raw[i] = (k == 0) ? 0 : (uint8_t)codec_leak_rand(&seed);
+        }
+        if (!is_decode) {
+            memcpy(inputs + k * stride, raw, CODEC_LEAK_LEN);
+        } else if ((len = ops->encode(raw, CODEC_LEAK_LEN, inputs + k * stride, enclen)) < 0) {
+            goto err;
+        }
+    }
+    inlen = is_decode ? (size_t)len : CODEC_LEAK_LEN;
+
+    for (i = 0; i < CODEC_LEAK_SAMPLES; i++) {
+        cls[i] = codec_leak_rand(&seed) & 1;
+        k = cls[i] ? 1 + codec_leak_rand(&seed) % CODEC_LEAK_INPUTS : 0;
+        /* Both classes are read from the same, cached address. */
+        memcpy(work, inputs + k * stride, inlen);
+        start = codec_now();
+        len = is_decode ? ops->decode(work, inlen, out, outlen) : ops->encode(work, inlen, out, outlen);
+        times[i] = codec_now() - start;
+        if (len < 0) {
+            goto err;
+        }
+    }
+
+    memcpy(sorted, times, CODEC_LEAK_SAMPLES * sizeof(*times));
+    qsort(sorted, CODEC_LEAK_SAMPLES, sizeof(*sorted), codec_leak_cmp);
+    crop = sorted[CODEC_LEAK_SAMPLES * 9 / 10];
+    for (i = 0; i < CODEC_LEAK_SAMPLES; i++) {
+        if (times[i] > crop) {
+            continue;
+        }
+        /* Welford's running mean and variance per class. */
+        k = cls[i];
+        n[k]++;
+        d = times[i] - mean[k];
+        mean[k] += d / n[k];
+        m2[k] += d * (times[i] - mean[k]);
+    }
+    if ((n[0] > 1) && (n[1] > 1)) {
+        d = m2[0] / (n[0] - 1) / n[0] + m2[1] / (n[1] - 1) / n[1];
+        t = (d > 0) ? (mean[0] - mean[1]) / sqrt(d) : 0;
+    }
+    printf("%-8s %-6s leak    fixed %.1f ns, random %.1f ns, |t| %.2f, %s\r\n", ops->name,
+           is_decode ? "decode" : "encode", mean[0] * 1e9, mean[1] * 1e9, fabs(t),
+           (fabs(t) > CODEC_LEAK_T_MAX) ? "timing depends on data" : "no leak detected");
+    ret = 0;
+err:
+    free(inputs);
+    free(work);
+    free(raw);
+    free(out);
+    free(cls);
+    free(times);
+    free(sorted);
+    return ret;
+}
+
+#define CODEC_RING_SLOTS (16)
+#define CODEC_RING_SLOT_MIN (64 * 1024)
+
+static int32_t codec_ring_print(struct codec_ring *ring, const struct codec_ops *ops, bool is_decode, int out_fd,
+                                bool newline) {
+    const uint8_t *out = NULL;
+    int32_t len = codec_ring_complete(ring, &out);
+
+    if (len < 0) {
+        PRINT_ERROR("%s %s failed!", ops->name, is_decode ? "decode" : "encode");
+        return -1;
+    }
+    /* Written straight from the ring slot, which is reused once this returns. */
+    return codec_out_write(out_fd, out, len, newline, false);
+}
+
+/*
+ * Same as the socket batch but every input and result goes through a shared
+ * memory ring.  1, with nothing written, if no ring could be opened.
+ */
+static int32_t codec_ring_main(const struct codec_ops *ops, const char *path, bool is_decode, int out_fd, bool newline,
+                               int count, char **inputs, const size_t *lens) {
+    struct codec_ring *ring = NULL;
+    size_t slot_size = CODEC_RING_SLOT_MIN;
+    uint8_t *in = NULL;
+    int32_t ret = -1;
+    int i = 0;
+
+    for (i = 0; i < count; i++) {
+        while (slot_size < lens[i]) {
+            slot_size *= 2;
+        }
+    }
+    ring = codec_ring_open(path, CODEC_RING_SLOTS, slot_size);
+    if (ring == NULL) {
+        PRINT_DEBUG("Failed to open ring on [%s], using the socket!", path);
+        return 1;
+    }
+
+    for (i = 0; i < count; i++) {
+        while ((in = codec_ring_slot_in(ring)) == NULL) {
+            if (codec_ring_print(ring, ops, is_decode, out_fd, newline) != 0) {
+                goto err;
+            }
+        }
+        memcpy(in, inputs[i], lens[i]);
+        if (codec_ring_submit(ring, codec_id_of(ops), is_decode, lens[i]) != 0) {
+            goto err;
+        }
+    }
+    while (codec_ring_pending(ring) > 0) {
+        if (codec_ring_print(ring, ops, is_decode, out_fd, newline) != 0) {
+            goto err;
+        }
+    }
+    ret = 0;
+err:
+    codec_ring_close(ring);
+    return ret;
+}
+
+/* Upper bound of the bytes a response occupies in the socket, header included. */
+static size_t codec_client_resp_size(const struct codec_ops *ops, bool is_decode, size_t srclength) {
+    return sizeof(struct codec_resp_hdr) + (is_decode ? ops->decode_len(srclength) : ops->encode_len(srclength));
+}
+
+/*
+ * Client mode: sends the file, or every INPUT argument, to the server,
+ * pipelining requests while the unread responses fit the window, and prints
+ * the results in order, one per line.
+ */
+static int32_t codec_client_main(const struct codec_ops *ops, const char *path, bool is_decode, bool use_ring,
+                                 const char *file, const char *output, int count, char **inputs) {
+    int32_t ret = -1, len = 0, id = codec_id_of(ops);
+    uint8_t *fbuff = NULL, *outbuf = NULL;
+    size_t flen = 0, outsize = 0, need = 0, pending = 0;
+    size_t *lens = NULL;
+    int out_fd = STDOUT_FILENO;
+    int fd = -1, i = 0, sent = 0, done = 0;
+
+    if (id < 0) {
+        return -1;
+    }
+    if (file != NULL) {
+        if (read_file(file, &fbuff, &flen) != 0) {
+            PRINT_ERROR("Failed to read file [%s]!", file);
+            goto err;
+        }
+        inputs = (char **)&fbuff;
+        count = 1;
+    }
+    if (count <= 0) {
+        goto err;
+    }
+    lens = calloc(count, sizeof(*lens));
+    if (lens == NULL) {
+        PRINT_ERROR("Failed to malloc!");
+        goto err;
+    }
+    for (i = 0; i < count; i++) {
+        lens[i] = (file != NULL) ? flen : strlen(inputs[i]);
+    }
+    if (output != NULL) {
+        out_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) {
+            PRINT_ERROR("Failed to open file [%s]!", output);
+            goto err;
+        }
+    }
+
+    /* 1 if the server has no worker to spare for a ring, fall back to the socket. */
+    if (use_ring) {
+        ret = codec_ring_main(ops, path, is_decode, out_fd, output == NULL, count, inputs, lens);
+        if (ret != 1) {
+            goto err;
+        }
+        ret = -1;
+    }
+
+    fd = codec_client_connect(path);
+    if (fd < 0) {
+        PRINT_ERROR("Failed to connect to [%s]!", path);
+        goto err;
+    }
+
+    for (i = 0; i < count; i++) {
+        need = is_decode ? ops->decode_len(lens[i]) : ops->encode_len(lens[i]);
+        outsize = (need > outsize) ? need : outsize;
+    }
+    outbuf = malloc(outsize);
+    if (outbuf == NULL) {
+        PRINT_ERROR("Failed to malloc!");
+        goto err;
+    }
+
+    /* Keep at most CODEC_CLIENT_WINDOW bytes of unread responses in flight, see daemon.h. */
+    for (sent = 0, done = 0; done < count;) {
+        need = (sent < count) ? codec_client_resp_size(ops, is_decode, lens[sent]) : 0;
+        if ((sent < count) && ((sent == done) || (pending + need <= CODEC_CLIENT_WINDOW))) {
+            if (codec_client_send(fd, id, is_decode, sent, inputs[sent], lens[sent]) != 0) {
+                PRINT_ERROR("Failed to send request [%d]!", sent);
+                goto err;
+            }
+            pending += need;
+            sent++;
+            continue;
+        }
+        len = codec_client_recv(fd, NULL, outbuf, outsize);
+        if (len < 0) {
+            PRINT_ERROR("%s %s failed for request [%d]!", ops->name, is_decode ? "decode" : "encode", done);
+            goto err;
+        }
+        if (codec_out_write(out_fd, outbuf, len, output == NULL, false) != 0) {
+            PRINT_ERROR("Failed to write result [%d]!", done);
+            goto err;
+        }
+        pending -= codec_client_resp_size(ops, is_decode, lens[done]);
+        done++;
+    }
+    ret = 0;
+err:
+    if ((out_fd >= 0) && (out_fd != STDOUT_FILENO)) {
+        close(out_fd);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(fbuff);
+    free(outbuf);
+    free(lens);
+    return ret;
+}
+
+/*
+ * --gzip/--zstd: streams the file or the INPUT argument through the
+ * compression and codec stages straight to the output file or stdout.
+ */
+static int32_t codec_pipe_main(const struct codec_ops *ops, bool is_decode, enum codec_pipe_comp comp, int32_t level,
+                               const char *file, const char *output, const char *input) {
+    struct codec_pipeline pl = {0};
+    int32_t ret = -1;
+
+    pl.ops = ops;
+    pl.is_decode = is_decode;
+    pl.comp = comp;
+    pl.level = level;
+    pl.in_fd = -1;
+    pl.out_fd = STDOUT_FILENO;
+
+    if (file != NULL) {
+        pl.in_fd = open(file, O_RDONLY);
+        if (pl.in_fd < 0) {
+            PRINT_ERROR("Failed to open file [%s]!", file);
+            goto err;
+        }
+    } else if (input != NULL) {
+        pl.input = (const uint8_t *)input;
+        pl.inlen = strlen(input);
+    } else {
+        return 1;
+    }
+    if (output != NULL) {
+        pl.out_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (pl.out_fd < 0) {
+            PRINT_ERROR("Failed to open file [%s]!", output);
+            goto err;
+        }
+    }
+
+    fflush(stdout);
+    if (codec_pipe_run(&pl) != 0) {
+        PRINT_ERROR("%s %s %s pipeline failed!", codec_pipe_name(comp), ops->name, is_decode ? "decode" : "encode");
+        goto err;
+    }
+    PRINT_DEBUG("%s %s pipeline wrote [%zu] bytes", codec_pipe_name(comp), ops->name, pl.outlen);
+    if ((output == NULL) && !is_decode && (codec_out_write(STDOUT_FILENO, NULL, 0, true, false) != 0)) {
+        goto err;
+    }
+    ret = 0;
+err:
+    if (pl.in_fd >= 0) {
+        close(pl.in_fd);
+    }
+    if ((pl.out_fd >= 0) && (pl.out_fd != STDOUT_FILENO)) {
+        close(pl.out_fd);
+    }
+    return ret;
+}
+
+/*
+ * --index writes the block index of the -f file to idx_path, FILE.idx by
+ * default.  --range=START:LEN decodes only the blocks covering that range
+ * of the decoded payload, through the index if it is there and current,
+ * else through an in-memory index from a whitespace counting scan.
+ */
+static int32_t codec_range_main(const struct codec_ops *ops, const char *file, const char *output,
+                                const char *idx_path, const char *range) {
+    struct codec_index idx = {0};
+    char path[PATH_MAX];
+    uint8_t *outbuf = NULL;
+    uint64_t start = 0;
+    size_t len = 0, outsize = 0;
+    char *end = NULL;
+    int32_t ret = -1;
+    int fd = -1;
+
+    if (file == NULL) {
+        PRINT_ERROR("--index and --range need -f <PATH>!");
+        return 1;
+    }
+    if (idx_path == NULL) {
+        snprintf(path, sizeof(path), "%s.idx", file);
+        idx_path = path;
+    }
+    fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        PRINT_ERROR("Failed to open file [%s]!", file);
+        return -1;
+    }
+
+    if (range == NULL) {
+        if ((codec_index_build(ops, fd, &idx) != 0) || (codec_index_save(&idx, idx_path) != 0)) {
+            PRINT_ERROR("Failed to write index [%s]!", idx_path);
+            goto err;
+        }
+        PRINT_DEBUG("Index [%s] [%lu] blocks of [%u] bytes, %s!", idx_path, (unsigned long)idx.hdr.count,
+                    idx.hdr.block, idx.hdr.dense ? "dense" : "with whitespace");
+        ret = 0;
+        goto err;
+    }
+
+    start = strtoull(range, &end, 0);
+    if ((end == range) || (*end != ':')) {
+        PRINT_ERROR("Bad range [%s], use START:LEN!", range);
+        ret = 1;
+        goto err;
+    }
+    len = strtoull(end + 1, &end, 0);
+    if ((*end != '\0') || (len == 0)) {
+        PRINT_ERROR("Bad range [%s], use START:LEN!", range);
+        ret = 1;
+        goto err;
+    }
+
+    if (codec_index_load(ops, fd, idx_path, &idx) != 0) {
+        PRINT_DEBUG("No usable index [%s], scanning [%s]!", idx_path, file);
+        if (codec_index_build(ops, fd, &idx) != 0) {
+            goto err;
+        }
+    }
+    if (start >= idx.hdr.dec_size) {
+        PRINT_ERROR("Range start [%lu] is past the decoded size [%lu]!", (unsigned long)start,
+                    (unsigned long)idx.hdr.dec_size);
+        goto err;
+    }
+    if (len > idx.hdr.dec_size - start) {
+        len = idx.hdr.dec_size - start;
+    }
+    outsize = len;
+    outbuf = codec_buf_alloc(outsize);
+    if (outbuf == NULL) {
+        PRINT_ERROR("Failed to malloc!");
+        goto err;
+    }
+    if (codec_index_pread(&idx, fd, outbuf, &len, start) != 0) {
+        PRINT_ERROR("%s decode of range [%s] failed!", ops->name, range);
+        goto err;
+    }
+
+    if (output != NULL) {
+        if (write_file(output, outbuf, len) != 0) {
+            PRINT_ERROR("Failed to write buff [%zu] to file [%s]!", len, output);
+            goto err;
+        }
+    } else if (codec_out_write(STDOUT_FILENO, outbuf, len, false, true) != 0) {
+        PRINT_ERROR("Failed to write buff [%zu] to stdout!", len);
+        goto err;
+    }
+    ret = 0;
+err:
+    codec_index_free(&idx);
+    codec_buf_free(outbuf, outsize);
+    close(fd);
+    return ret;
+}
+
+static void print_usage(const struct codec_ops *ops, const char *exe_name) {
+    printf("%s encode and decode tools.\r\n", ops->name);
+    printf("Usage: %s [options] [INPUT]...\r\n", exe_name);
+    printf("Options:\r\n");
+    printf("    -h,--help                        Show this help message.\r\n");
+    printf("    -V,--version                     Show the kernel variants and build options.\r\n");
+    printf("    -d,--decode                      Decode input. Default use encode.\r\n");
+    printf("    -f <PATH>,--file=<PATH>          Iutput file path.\r\n");
+    printf("    -o <PATH>,--output=<PATH>        Output file path.\r\n");
+    printf("    -t <COUNT>,--threads=<COUNT>     Worker threads for file input, 0 for one per CPU.\r\n");
+    printf("    -b <COUNT>,--bench=<COUNT>       Run the codec COUNT times and report throughput.\r\n");
+    printf("    -S <PATH>,--server=<PATH>        Serve requests on Unix socket PATH with -t workers.\r\n");
+    printf("    -C <PATH>,--connect=<PATH>       Send the input(s) to the server on PATH.\r\n");
+    printf("    -r,--ring                        With -C, pass data through a shared memory ring.\r\n");
+    printf("    --gzip[=LEVEL]                   Gzip compress before encode, decompress after decode.\r\n");
+    printf("    --zstd[=LEVEL]                   Zstd compress before encode, decompress after decode.\r\n");
+    printf("    --index[=PATH]                   Write the block index of the -f file, FILE.idx by default.\r\n");
+    printf("    --range=START:LEN                Decode only LEN bytes at START of the -f file, using the index.\r\n");
+    if (ops->ct != NULL) {
+        printf("    --ct                             Use the constant-time codec, for keys and other secrets.\r\n");
+    }
+    if (ops->set_key != NULL) {
+        printf("    -k <STRING>,--key=<STRING>       Encode/decode key.\r\n");
+    }
+}
+
+int codec_main(const struct codec_ops *ops, int argc, char **argv) {
+    int32_t ret = 0;
+    char *file = NULL;
+    char *key = NULL;
+    char *output = NULL;
+    char *server = NULL;
+    char *connect = NULL;
+    uint8_t *input = NULL;
+    uint8_t *outbuf = NULL;
+
+    size_t inlen = 0, insize = 0;
+    size_t outlen = 0, outsize = 0;
+
+    struct codec_job job = {0};
+    struct stat st;
+    int fd = -1;
+
+    bool is_decode = false;
+    bool use_ring = false;
+    enum codec_pipe_comp comp = CODEC_PIPE_NONE;
+    int32_t level = 0;
+    bool use_index = false;
+    char *idx_path = NULL;
+    char *range = NULL;
+    uint32_t bench = 0;
+    uint32_t threads = 1;
+
+    int opt = 0, opt_index = 0;
+
+    static struct option long_options[] = {{"help", no_argument, 0, 'h'},         {"version", no_argument, 0, 'V'},
+                                           {"decode", no_argument, 0, 'd'},
+                                           {"key", required_argument, 0, 'k'},    {"file", required_argument, 0, 'f'},
+                                           {"output", required_argument, 0, 'o'}, {"bench", required_argument, 0, 'b'},
+                                           {"threads", required_argument, 0, 't'},
+                                           {"server", required_argument, 0, 'S'}, {"connect", required_argument, 0, 'C'},
+                                           {"ring", no_argument, 0, 'r'},
+                                           {"gzip", optional_argument, 0, CODEC_OPT_GZIP},
+                                           {"zstd", optional_argument, 0, CODEC_OPT_ZSTD},
+                                           {"index", optional_argument, 0, CODEC_OPT_INDEX},
+                                           {"range", required_argument, 0, CODEC_OPT_RANGE},
+                                           {"ct", no_argument, 0, CODEC_OPT_CT},
+                                           {0, 0, 0, 0}};
+
+    while ((opt = getopt_long(argc, argv, "f:o:dk:b:t:S:C:rVh", long_options, &opt_index)) != -1) {
+        switch (opt) {
+            case 'f':
+                file = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'd':
+                is_decode = true;
+                break;
+            case 'k':
+                if (ops->set_key == NULL) {
+                    PRINT_ERROR("Unknown option -- %c\n\n", opt);
+                    ret = 1;
+                    goto err;
+                }
+                key = optarg;
+                break;
+            case 'b':
+                bench = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                threads = strtoul(optarg, NULL, 0);
+                break;
+            case 'S':
+                server = optarg;
+                break;
+            case 'C':
+                connect = optarg;
+                break;
+            case 'r':
+                use_ring = true;
+                break;
+            case CODEC_OPT_GZIP:
+            case CODEC_OPT_ZSTD:
+                comp = (opt == CODEC_OPT_GZIP) ? CODEC_PIPE_GZIP : CODEC_PIPE_ZSTD;
+                level = (optarg != NULL) ? strtol(optarg, NULL, 0) : 0;
+                break;
+            case CODEC_OPT_INDEX:
+                use_index = true;
+                idx_path = optarg;
+                break;
+            case CODEC_OPT_RANGE:
+                range = optarg;
+                break;
+            case CODEC_OPT_CT:
+                if (ops->ct == NULL) {
+                    PRINT_ERROR("%s has no constant-time variant!", ops->name);
+                    ret = 1;
+                    goto err;
+                }
+                ops = ops->ct;
+                break;
+            case 'V':
+                codec_print_build(ops);
+                ret = 0;
+                goto err;
+            case 'h':
+                ret = 1;
+                goto err;
+            default:
+                ret = 1;
+                goto err;
+        }
+    }
+
+    if (key != NULL) {
+        PRINT_DEBUG("Input Key [%s]!", key);
+        if (ops->set_key(key) == 0) {
+            PRINT_DEBUG("Use %s Key [%s]!", ops->name, key);
+        }
+    }
+
+    if (server != NULL) {
+        ret = codec_server_run(server, threads);
+        goto err;
+    }
+
+    if (connect != NULL) {
+        ret = codec_client_main(ops, connect, is_decode, use_ring, file, output, argc - optind, argv + optind);
+        goto err;
+    }
+
+    if (use_index || (range != NULL)) {
+        ret = codec_range_main(ops, file, output, idx_path, range);
+        goto err;
+    }
+
+    if (comp != CODEC_PIPE_NONE) {
+        ret = codec_pipe_main(ops, is_decode, comp, level, file, output, (optind < argc) ? argv[optind] : NULL);
+        goto err;
+    }
+
+    if (file == NULL) {
+        if (optind >= argc) {
+            ret = 1;
+            goto err;
+        }
+        inlen = strlen(argv[optind]);
+        input = codec_buf_alloc(inlen + 1);
+        if (input == NULL) {
+            PRINT_ERROR("Failed to malloc!");
+            ret = -1;
+            goto err;
+        }
+        memcpy(input, argv[optind], inlen + 1);
+        PRINT_DEBUG("Get string [%s] size [%zu]!", input, inlen);
+    } else {
+        fd = open(file, O_RDONLY);
+        if ((fd < 0) || (fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+            PRINT_ERROR("Failed to open file [%s]!", file);
+            ret = -1;
+            goto err;
+        }
+        inlen = st.st_size;
+        /* Not touched here, the workers fault in their own chunks. */
+        input = codec_buf_alloc(inlen + 1);
+        if (input == NULL) {
+            PRINT_ERROR("Failed to malloc!");
+            ret = -1;
+            goto err;
+        }
+        PRINT_DEBUG("Input file [%s] size [%zu]!", file, inlen);
+    }
+    insize = inlen + 1;
+
+    outsize = is_decode ? ops->decode_len(inlen) : ops->encode_len(inlen);
+    outbuf = codec_buf_alloc(outsize);
+    if (outbuf == NULL) {
+        PRINT_ERROR("Failed to malloc!");
+        ret = -1;
+        goto err;
+    }
+
+    job.ops = ops;
+    job.is_decode = is_decode;
+    job.threads = threads;
+    job.fd = fd;
+    job.input = input;
+    job.inlen = inlen;
+    job.output = outbuf;
+    job.outsize = outsize;
+
+    if (bench > 0) {
+        if ((codec_job_load(&job) != 0) ||
+            (codec_bench(ops, is_decode, bench, input, inlen, outbuf, outsize) != 0) ||
+            ((ops->ct != NULL) && (codec_bench_leak(ops, is_decode) != 0)) ||
+            ((ops->ct != NULL) && (ops->ct != ops) && (codec_bench_leak(ops->ct, is_decode) != 0))) {
+            PRINT_ERROR("%s %s failed!", ops->name, is_decode ? "decode" : "encode");
+            ret = -1;
+            goto err;
+        }
+        ret = 0;
+        goto err;
+    }
+
+    if ((codec_job_run(&job) != 0) || (job.outlen == 0)) {
+        PRINT_ERROR("%s %s failed!", ops->name, is_decode ? "decode" : "encode");
+        ret = -1;
+        goto err;
+    }
+    outlen = job.outlen;
+
+    if (output != NULL) {
+        PRINT_DEBUG("output file name [%s]", output);
+        if (write_file(output, outbuf, outlen) != 0) {
+            PRINT_ERROR("Failed to write buff [%zu] to file [%s]!\n", outlen, output);
+            ret = -1;
+            goto err;
+        }
+    } else {
+        /* outbuf is only unmapped from here on, a pipe may keep its pages. */
+        PRINT_DEBUG("Write [%zu] bytes to %s!", outlen, codec_out_name(codec_out_kind(STDOUT_FILENO)));
+        if (codec_out_write(STDOUT_FILENO, outbuf, outlen, !is_decode, true) != 0) {
+            PRINT_ERROR("Failed to write buff [%zu] to stdout!", outlen);
+            ret = -1;
+            goto err;
+        }
+    }
+
+    ret = 0;
+
+err:
+    codec_buf_free(input, insize);
+    codec_buf_free(outbuf, outsize);
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (ret) {
+        print_usage(ops, argv[0]);
+    }
+    return ret;
+}
@@ -0,0 +1,80 @@
+#ifndef __CODEC_H__
+#define __CODEC_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * One binary-to-text encoding as seen by the shared driver.
+ *
+ * encode/decode follow the base64_encode()/base64_decode() convention: the
+ * caller owns dest, the return value is the number of bytes stored (the
+ * terminating '\0' is not counted) or -1 on error.  encode_len/decode_len
+ * return a dest size that is always large enough for srclength input bytes.
+ */
+struct codec_ops {
+    const char *name;     /* Human readable name, "Base64". */
+
+    size_t enc_block; /* Input bytes per encoded group, 3 for base64. */
+    size_t dec_block; /* Characters per encoded group, 4 for base64. */
+    char pad;         /* Padding character, '\0' if the encoding has none. */
+
+    size_t (*encode_len)(size_t srclength);
+    size_t (*decode_len)(size_t srclength);
+    int32_t (*encode)(const void *src, size_t srclength, void *dest, size_t targsize);
+    int32_t (*decode)(const void *src, size_t srclength, void *dest, size_t targsize);
+
+    /* Optional, replaces the alphabet. NULL if the codec has no -k option. */
+    int32_t (*set_key)(const char *key);
+
+    /*
+     * Optional, for encodings with variable sized groups (Ascii85 'z').
+     * Returns how many of the srclength whitespace free characters form
+     * complete groups. NULL means srclength rounded down to dec_block.
+     */
+    size_t (*dec_split)(const char *src, size_t srclength);
+
+    /*
+     * Encoded groups vary in size (Ascii85 'z'), so the encoder's output
+     * can't be split at fixed offsets either.
+     */
+    bool enc_var;
+
+    /*
+     * Optional, the constant-time variant of this codec (itself for the
+     * variant), whose timing does not depend on the data.  NULL if none.
+     */
+    const struct codec_ops *ct;
+};
+
+/*
+ * Streaming context: feeds arbitrary sized pieces through a codec and keeps
+ * the bytes of an incomplete group in carry until the next update.
+ * Whitespace is dropped from decode input before it reaches ops->decode.
+ */
+#define CODEC_STREAM_CARRY (8)
+#define CODEC_STREAM_BLOCK (4096)
+
+struct codec_stream {
+    const struct codec_ops *ops;
+    bool is_decode;
+    bool done; /* Decode saw the padding, only whitespace may follow. */
+    size_t carry_len;
+    uint8_t carry[CODEC_STREAM_CARRY];
+};
+
+void codec_stream_init(struct codec_stream *ctx, const struct codec_ops *ops, bool is_decode);
+size_t codec_stream_bound(const struct codec_stream *ctx, size_t srclength);
+int32_t codec_stream_update(struct codec_stream *ctx, const void *src, size_t srclength, void *dest, size_t targsize);
+int32_t codec_stream_final(struct codec_stream *ctx, void *dest, size_t targsize);
+
+int read_file(const char *file, uint8_t **fbuff, size_t *pflen);
+int write_file(const char *file, const uint8_t *fbuff, size_t flen);
+
+int codec_main(const struct codec_ops *ops, int argc, char **argv);
+
+#endif
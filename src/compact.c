@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COMPACT_HAVE_SSSE3 1
+#endif
+
+#include "compact.h"
+
+static inline bool codec_is_space(uint8_t ch) {
+    return (ch == ' ') || ((uint8_t)(ch - '\t') <= ('\r' - '\t'));
+}
+
+static size_t codec_space_count_scalar(const uint8_t *src, size_t len) {
+    size_t i = 0, n = 0;
+
+    for (i = 0; i < len; i++) {
+        n += codec_is_space(src[i]);
+    }
+    return n;
+}
+
+/*
+ * Branch-free per byte: every byte is stored at dst + j and j only moves on
+ * past the kept ones.  Once j reaches cap whatever is left must be
+ * whitespace, so stopping there keeps every store below dst + cap.
+ */
+static size_t codec_space_strip_scalar(uint8_t *dst, size_t cap, const uint8_t *src, size_t len) {
+    size_t i = 0, j = 0;
+
+    for (i = 0; (i < len) && (j < cap); i++) {
+        dst[j] = src[i];
+        j += !codec_is_space(src[i]);
+    }
+    return j;
+}
+
+#ifdef COMPACT_HAVE_SSSE3
+/*
+ * pshufb control per 8-bit keep mask: the indexes of the kept bytes in
+ * order, then 0x80 (zero) for the rest.  One lookup packs 8 bytes.
+ */
+static uint8_t codec_pack_table[256][8];
+
+__attribute__((constructor)) static void codec_pack_table_init(void) {
+    uint32_t keep = 0, bit = 0, n = 0;
+
+    for (keep = 0; keep < 256; keep++) {
+        memset(codec_pack_table[keep], 0x80, 8);
+        for (bit = 0, n = 0; bit < 8; bit++) {
+            if (keep & (1u << bit)) {
+                codec_pack_table[keep][n++] = bit;
+            }
+        }
+    }
+}
+
+/* 0xFF in every byte lane that holds ' ', '\t', '\n', '\v', '\f' or '\r'. */
+__attribute__((target("ssse3"))) static inline __m128i codec_space_mask(__m128i c) {
+    __m128i t = _mm_sub_epi8(c, _mm_set1_epi8('\t'));
+    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8('\r' - '\t')), t);
+
+    return _mm_or_si128(ctl, _mm_cmpeq_epi8(c, _mm_set1_epi8(' ')));
+}
+
+__attribute__((target("ssse3,popcnt"))) static size_t codec_space_count_ssse3(const uint8_t *src, size_t len) {
+    size_t i = 0, n = 0;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        n += __builtin_popcount(_mm_movemask_epi8(codec_space_mask(_mm_loadu_si128((const __m128i *)(src + i)))));
+    }
+    return n + codec_space_count_scalar(src + i, len - i);
+}
+
+__attribute__((target("ssse3,popcnt"))) static size_t codec_space_strip_ssse3(uint8_t *dst, size_t cap,
+                                                                               const uint8_t *src, size_t len) {
+    size_t i = 0, j = 0;
+    uint32_t mask = 0, keep_lo = 0, keep_hi = 0;
+    __m128i c, lo, hi;
+
+    /* Every store stays below dst + j + 16, so stop 16 short of cap. */
+    for (i = 0; (i + 16 <= len) && (j + 16 <= cap); i += 16) {
+        c = _mm_loadu_si128((const __m128i *)(src + i));
+        mask = _mm_movemask_epi8(codec_space_mask(c));
+        if (mask == 0) {
+            _mm_storeu_si128((__m128i *)(dst + j), c);
+            j += 16;
+            continue;
+        }
+        keep_lo = ~mask & 0xFF;
+        keep_hi = (~mask >> 8) & 0xFF;
+        lo = _mm_shuffle_epi8(c, _mm_loadl_epi64((const __m128i *)codec_pack_table[keep_lo]));
+        hi = _mm_shuffle_epi8(_mm_srli_si128(c, 8), _mm_loadl_epi64((const __m128i *)codec_pack_table[keep_hi]));
+        _mm_storel_epi64((__m128i *)(dst + j), lo);
+        j += __builtin_popcount(keep_lo);
+        _mm_storel_epi64((__m128i *)(dst + j), hi);
+        j += __builtin_popcount(keep_hi);
+    }
+    return j + codec_space_strip_scalar(dst + j, cap - j, src + i, len - i);
+}
+#endif
+
+size_t codec_space_count(const uint8_t *src, size_t len) {
+#ifdef COMPACT_HAVE_SSSE3
+    if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("popcnt")) {
+        return codec_space_count_ssse3(src, len);
+    }
+#endif
+    return codec_space_count_scalar(src, len);
+}
+
+size_t codec_space_strip(uint8_t *dst, size_t cap, const uint8_t *src, size_t len) {
+#ifdef COMPACT_HAVE_SSSE3
+    if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("popcnt")) {
+        return codec_space_strip_ssse3(dst, cap, src, len);
+    }
+#endif
+    return codec_space_strip_scalar(dst, cap, src, len);
+}
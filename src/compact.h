@@ -0,0 +1,24 @@
+#ifndef __COMPACT_H__
+#define __COMPACT_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Whitespace (isspace() in the C locale) removal for decoder input.  Both
+ * work 16 bytes at a time with SSSE3 when the CPU has it.
+ *
+ * codec_space_count() returns how many whitespace bytes src holds, so
+ * chunked decoders can prefix-sum the dense offsets before compacting.
+ * codec_space_strip() left-packs the other bytes of src into dst, which may
+ * be src itself, and returns their number.  It never writes at or past
+ * dst + cap; cap must be at least that number.
+ */
+size_t codec_space_count(const uint8_t *src, size_t len);
+size_t codec_space_strip(uint8_t *dst, size_t cap, const uint8_t *src, size_t len);
+
+#endif
@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "log.h"
+#include "base64.h"
+#include "base16.h"
+#include "base32.h"
+#include "base85.h"
+#include "daemon.h"
+#include "shmring.h"
+
+#define CODEC_SERVER_MAX_THREADS (256)
+#define CODEC_SERVER_PREWARM (64 * 1024)
+
+/* A ring holds its worker until it closes, rings may take all workers but one. */
+static uint32_t codec_server_rings;
+static uint32_t codec_server_max_rings;
+
+static const struct codec_ops *codec_table[CODEC_ID_MAX] = {
+    [CODEC_ID_BASE64] = &base64_ops,  [CODEC_ID_BASE16] = &base16_ops, [CODEC_ID_BASE32] = &base32_ops,
+    [CODEC_ID_ASCII85] = &ascii85_ops, [CODEC_ID_Z85] = &z85_ops,
+};
+
+const struct codec_ops *codec_by_id(uint8_t codec) {
+    const struct codec_ops *ops = NULL;
+
+    if ((codec & ~CODEC_ID_CT) >= CODEC_ID_MAX) {
+        return NULL;
+    }
+    ops = codec_table[codec & ~CODEC_ID_CT];
+    return (codec & CODEC_ID_CT) ? ops->ct : ops;
+}
+
+int32_t codec_id_of(const struct codec_ops *ops) {
+    int32_t i = 0;
+
+    for (i = 0; i < CODEC_ID_MAX; i++) {
+        if (codec_table[i] == ops) {
+            return i;
+        }
+        if (codec_table[i]->ct == ops) {
+            return i | CODEC_ID_CT;
+        }
+    }
+    return -1;
+}
+
+static int32_t codec_read_full(int fd, void *buf, size_t len) {
+    uint8_t *p = buf;
+    ssize_t rsize = 0;
+
+    while (len > 0) {
+        rsize = read(fd, p, len);
+        if (rsize < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return -1;
+        }
+        if (rsize == 0) {
+            return -1;
+        }
+        p += rsize;
+        len -= rsize;
+    }
+    return 0;
+}
+
+static int32_t codec_writev_full(int fd, struct iovec *iov, int iovcnt) {
+    ssize_t wsize = 0;
+
+    while (iovcnt > 0) {
+        wsize = writev(fd, iov, iovcnt);
+        if (wsize < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return -1;
+        }
+        while ((iovcnt > 0) && ((size_t)wsize >= iov->iov_len)) {
+            wsize -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + wsize;
+            iov->iov_len -= wsize;
+        }
+    }
+    return 0;
+}
+
+/* Per worker buffers, kept across requests and only ever grown. */
+struct codec_pool {
+    uint8_t *in;
+    size_t insize;
+    uint8_t *out;
+    size_t outsize;
+};
+
+static int32_t codec_pool_reserve(uint8_t **buf, size_t *size, size_t len) {
+    uint8_t *p = NULL;
+    size_t grow = (*size > 0) ? *size : CODEC_SERVER_PREWARM;
+
+    if (len <= *size) {
+        return 0;
+    }
+    while (grow < len) {
+        grow *= 2;
+    }
+    p = realloc(*buf, grow);
+    if (p == NULL) {
+        return -1;
+    }
+    *buf = p;
+    *size = grow;
+    return 0;
+}
+
+static void codec_server_conn(int fd, struct codec_pool *pool) {
+    struct codec_req_hdr req;
+    struct codec_resp_hdr resp;
+    const struct codec_ops *ops = NULL;
+    struct iovec iov[2];
+    size_t outlen = 0;
+    int32_t ret = 0;
+
+    while (codec_read_full(fd, &req, sizeof(req)) == 0) {
+        if ((req.magic != CODEC_REQ_MAGIC) || (req.len > CODEC_REQ_MAX)) {
+            break;
+        }
+        if ((codec_pool_reserve(&pool->in, &pool->insize, req.len + 1) != 0) ||
+            (codec_read_full(fd, pool->in, req.len) != 0)) {
+            break;
+        }
+        pool->in[req.len] = '\0';
+
+        /* The connection now belongs to a shared memory ring until the client drops it. */
+        if ((req.op == CODEC_OP_RING) && (req.len == sizeof(struct codec_ring_cfg))) {
+            if (__atomic_add_fetch(&codec_server_rings, 1, __ATOMIC_SEQ_CST) <= codec_server_max_rings) {
+                codec_ring_serve(fd, (const struct codec_ring_cfg *)pool->in);
+            } else {
+                PRINT_DEBUG("Ring refused, [%u] workers already serve rings!", codec_server_max_rings);
+                resp.magic = CODEC_REQ_MAGIC;
+                resp.status = -1;
+                resp.id = req.id;
+                resp.len = 0;
+                iov[0].iov_base = &resp;
+                iov[0].iov_len = sizeof(resp);
+                codec_writev_full(fd, iov, 1);
+            }
+            __atomic_sub_fetch(&codec_server_rings, 1, __ATOMIC_SEQ_CST);
+            break;
+        }
+
+        resp.magic = CODEC_REQ_MAGIC;
+        resp.status = -1;
+        resp.id = req.id;
+        resp.len = 0;
+
+        ops = codec_by_id(req.codec);
+        if ((ops != NULL) && (req.op <= CODEC_OP_DECODE)) {
+            outlen = (req.op == CODEC_OP_DECODE) ? ops->decode_len(req.len) : ops->encode_len(req.len);
+            if (codec_pool_reserve(&pool->out, &pool->outsize, outlen) == 0) {
+                if (req.op == CODEC_OP_DECODE) {
+                    ret = ops->decode(pool->in, req.len, pool->out, outlen);
+                } else {
+                    ret = ops->encode(pool->in, req.len, pool->out, outlen);
+                }
+                if (ret >= 0) {
+                    resp.status = 0;
+                    resp.len = ret;
+                }
+            }
+        }
+
+        iov[0].iov_base = &resp;
+        iov[0].iov_len = sizeof(resp);
+        iov[1].iov_base = pool->out;
+        iov[1].iov_len = resp.len;
+        if (codec_writev_full(fd, iov, 2) != 0) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+static void *codec_server_worker(void *arg) {
+    int lfd = (int)(intptr_t)arg;
+    struct codec_pool pool = {0};
+    int fd = -1;
+
+    /* Pre-warm so the first requests don't pay for allocation. */
+    codec_pool_reserve(&pool.in, &pool.insize, CODEC_SERVER_PREWARM);
+    codec_pool_reserve(&pool.out, &pool.outsize, CODEC_SERVER_PREWARM);
+
+    for (;;) {
+        fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            PRINT_ERROR("Failed to accept [%s]!", strerror(errno));
+            break;
+        }
+        codec_server_conn(fd, &pool);
+    }
+    free(pool.in);
+    free(pool.out);
+    return NULL;
+}
+
+int32_t codec_server_run(const char *path, uint32_t threads) {
+    pthread_t tids[CODEC_SERVER_MAX_THREADS];
+    struct sockaddr_un addr;
+    uint32_t i = 0, started = 0;
+    long cpus = 0;
+    int lfd = -1;
+
+    if ((path == NULL) || (strlen(path) >= sizeof(addr.sun_path))) {
+        return -1;
+    }
+    if (threads == 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? cpus : 1;
+    }
+    if (threads > CODEC_SERVER_MAX_THREADS) {
+        threads = CODEC_SERVER_MAX_THREADS;
+    }
+
+    codec_server_max_rings = threads - 1;
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lfd < 0) {
+        PRINT_ERROR("Failed to create socket [%s]!", strerror(errno));
+        return -1;
+    }
+    unlink(path);
+    if ((bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0) || (listen(lfd, SOMAXCONN) != 0)) {
+        PRINT_ERROR("Failed to listen on [%s] [%s]!", path, strerror(errno));
+        close(lfd);
+        return -1;
+    }
+    PRINT_DEBUG("Listen on [%s] with [%u] workers!", path, threads);
+
+    /* The calling thread is the last worker. */
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(&tids[started], NULL, codec_server_worker, (void *)(intptr_t)lfd) != 0) {
+            break;
+        }
+        started++;
+    }
+    codec_server_worker((void *)(intptr_t)lfd);
+    for (i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    close(lfd);
+    return -1;
+}
+
+int codec_client_connect(const char *path) {
+    struct sockaddr_un addr;
+    int fd = -1;
+
+    if ((path == NULL) || (strlen(path) >= sizeof(addr.sun_path))) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int32_t codec_client_send(int fd, uint8_t codec, bool is_decode, uint32_t id, const void *src, size_t srclength) {
+    struct codec_req_hdr req;
+    struct iovec iov[2];
+
+    if (srclength > CODEC_REQ_MAX) {
+        return -1;
+    }
+    memset(&req, 0, sizeof(req));
+    req.magic = CODEC_REQ_MAGIC;
+    req.codec = codec;
+    req.op = is_decode ? CODEC_OP_DECODE : CODEC_OP_ENCODE;
+    req.id = id;
+    req.len = srclength;
+
+    iov[0].iov_base = &req;
+    iov[0].iov_len = sizeof(req);
+    iov[1].iov_base = (void *)src;
+    iov[1].iov_len = srclength;
+    return codec_writev_full(fd, iov, 2);
+}
+
+int32_t codec_client_recv(int fd, uint32_t *id, void *dest, size_t targsize) {
+    struct codec_resp_hdr resp;
+    uint8_t drain[256];
+    size_t len = 0, chunk = 0;
+
+    if ((codec_read_full(fd, &resp, sizeof(resp)) != 0) || (resp.magic != CODEC_REQ_MAGIC)) {
+        return -1;
+    }
+    if (id != NULL) {
+        *id = resp.id;
+    }
+    if (resp.len <= targsize) {
+        if (codec_read_full(fd, dest, resp.len) != 0) {
+            return -1;
+        }
+        if (resp.len < targsize) {
+            ((uint8_t *)dest)[resp.len] = '\0';
+        }
+        return (resp.status == 0) ? (int32_t)resp.len : -1;
+    }
+
+    /* Too small, skip the payload so the next response stays in frame. */
+    for (len = resp.len; len > 0; len -= chunk) {
+        chunk = (len < sizeof(drain)) ? len : sizeof(drain);
+        if (codec_read_full(fd, drain, chunk) != 0) {
+            break;
+        }
+    }
+    return -1;
+}
+
+int32_t codec_client_call(int fd, uint8_t codec, bool is_decode, const void *src, size_t srclength, void *dest,
+                          size_t targsize) {
+    if (codec_client_send(fd, codec, is_decode, 0, src, srclength) != 0) {
+        return -1;
+    }
+    return codec_client_recv(fd, NULL, dest, targsize);
+}
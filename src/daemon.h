@@ -0,0 +1,73 @@
+#ifndef __DAEMON_H__
+#define __DAEMON_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "codec.h"
+
+/*
+ * Framed request/response protocol over a local SOCK_STREAM Unix socket.
+ * Every request is a header followed by len payload bytes, every response
+ * a header followed by len result bytes.  Requests on one connection are
+ * answered in order.  The server stops reading while a response write
+ * blocks, so a client that pipelines requests must keep reading: it may only
+ * send another request while the responses it has not read yet fit in
+ * CODEC_CLIENT_WINDOW bytes (well below the socket buffer), or when none
+ * are outstanding.  Fields are in host byte order, both ends run on the same
+ * machine.
+ */
+#define CODEC_REQ_MAGIC (0x43444331) /* "CDC1" */
+#define CODEC_CLIENT_WINDOW (64U * 1024)
+#define CODEC_REQ_MAX (64U * 1024 * 1024)
+
+enum codec_id {
+    CODEC_ID_BASE64 = 0,
+    CODEC_ID_BASE16,
+    CODEC_ID_BASE32,
+    CODEC_ID_ASCII85,
+    CODEC_ID_Z85,
+    CODEC_ID_MAX,
+};
+
+/* Or'ed into a codec id to select the codec's constant-time variant (ops->ct). */
+#define CODEC_ID_CT (0x80)
+
+#define CODEC_OP_ENCODE (0)
+#define CODEC_OP_DECODE (1)
+#define CODEC_OP_RING (2) /* Payload is a struct codec_ring_cfg, see shmring.h. */
+
+struct codec_req_hdr {
+    uint32_t magic;
+    uint8_t codec; /* enum codec_id */
+    uint8_t op;    /* CODEC_OP_ENCODE or CODEC_OP_DECODE */
+    uint16_t flags;
+    uint32_t id; /* Echoed back in the response. */
+    uint32_t len;
+};
+
+struct codec_resp_hdr {
+    uint32_t magic;
+    int32_t status; /* 0 or -1, len is 0 on error. */
+    uint32_t id;
+    uint32_t len;
+};
+
+const struct codec_ops *codec_by_id(uint8_t codec);
+int32_t codec_id_of(const struct codec_ops *ops);
+
+/* Serves requests on path with threads pre-started workers, 0 for one per CPU. Only returns on error. */
+int32_t codec_server_run(const char *path, uint32_t threads);
+
+int codec_client_connect(const char *path);
+int32_t codec_client_send(int fd, uint8_t codec, bool is_decode, uint32_t id, const void *src, size_t srclength);
+/* Receives the next response into dest, returns its length or -1. */
+int32_t codec_client_recv(int fd, uint32_t *id, void *dest, size_t targsize);
+int32_t codec_client_call(int fd, uint8_t codec, bool is_decode, const void *src, size_t srclength, void *dest,
+                          size_t targsize);
+
+#endif
@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "kernel.h"
+
+#ifndef CODEC_PGO_MODE
+#define CODEC_PGO_MODE (0) /* 1 generate, 2 use. */
+#endif
+
+const char *codec_kernel_variants(void) {
+    return CODEC_KERNEL_VARIANTS;
+}
+
+const char *codec_kernel_active(void) {
+#ifdef CODEC_MULTIVERSION
+    /* Same order as the resolvers try the clones. */
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("x86-64-v4")) {
+        return "x86-64-v4";
+    }
+    if (__builtin_cpu_supports("x86-64-v3")) {
+        return "x86-64-v3";
+    }
+    if (__builtin_cpu_supports("x86-64-v2")) {
+        return "x86-64-v2";
+    }
+#endif
+    return "default";
+}
+
+const char *codec_build_opts(void) {
+#if defined(CODEC_LTO_ENABLED) && (CODEC_PGO_MODE == 1)
+    return "LTO, PGO generate";
+#elif defined(CODEC_LTO_ENABLED) && (CODEC_PGO_MODE == 2)
+    return "LTO, PGO use";
+#elif defined(CODEC_LTO_ENABLED)
+    return "LTO";
+#elif (CODEC_PGO_MODE == 1)
+    return "PGO generate";
+#elif (CODEC_PGO_MODE == 2)
+    return "PGO use";
+#else
+    return "none";
+#endif
+}
@@ -0,0 +1,31 @@
+#ifndef __KERNEL_H__
+#define __KERNEL_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * CODEC_KERNEL marks the hot encode/decode loops.  With CODEC_MULTIVERSION
+ * (the default on x86-64, see CMakeLists.txt) each one is compiled once per
+ * x86-64 microarchitecture level and an ifunc resolver picks the best clone
+ * for the CPU when the binary is loaded, so one binary runs everywhere and
+ * still gets AVX-512/AVX2/BMI2 code generation where it is available.  The
+ * explicit SSSE3 kernels keep their own run time dispatch.
+ */
+#ifdef CODEC_MULTIVERSION
+#define CODEC_KERNEL __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#define CODEC_KERNEL_VARIANTS "x86-64-v4 x86-64-v3 x86-64-v2 default"
+#else
+#define CODEC_KERNEL
+#define CODEC_KERNEL_VARIANTS "default"
+#endif
+
+/* Clones compiled in, and the one the resolvers pick on this CPU. */
+const char *codec_kernel_variants(void);
+const char *codec_kernel_active(void);
+/* LTO and PGO state of this build, "LTO, PGO use" or "none". */
+const char *codec_build_opts(void);
+
+#endif
@@ -0,0 +1,137 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "log.h"
+#include "output.h"
+
+/* Below this copying into the pipe is cheaper than pinning the pages. */
+#define CODEC_OUT_SPLICE_MIN (64 * 1024)
+
+enum codec_out_kind codec_out_kind(int fd) {
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        return CODEC_OUT_FILE;
+    }
+    if (S_ISFIFO(st.st_mode)) {
+        return CODEC_OUT_PIPE;
+    }
+    if (S_ISSOCK(st.st_mode)) {
+        return CODEC_OUT_SOCKET;
+    }
+    return isatty(fd) ? CODEC_OUT_TTY : CODEC_OUT_FILE;
+}
+
+const char *codec_out_name(enum codec_out_kind kind) {
+    switch (kind) {
+        case CODEC_OUT_TTY:
+            return "tty";
+        case CODEC_OUT_PIPE:
+            return "pipe";
+        case CODEC_OUT_SOCKET:
+            return "socket";
+        default:
+            return "file";
+    }
+}
+
+/* Best effort, above /proc/sys/fs/pipe-max-size the pipe just stays as is. */
+static void codec_out_grow(int fd, size_t len) {
+    int cur = fcntl(fd, F_GETPIPE_SZ);
+    size_t want = (len < CODEC_OUT_PIPE_SIZE) ? len : CODEC_OUT_PIPE_SIZE;
+
+    if ((cur >= 0) && ((size_t)cur < want)) {
+        fcntl(fd, F_SETPIPE_SZ, (int)want);
+    }
+}
+
+/* stdout may have been left non-blocking by the parent. */
+static int32_t codec_out_wait(int fd) {
+    struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+
+    return ((poll(&pfd, 1, -1) < 0) && (errno != EINTR)) ? -1 : 0;
+}
+
+static int32_t codec_out_writev(int fd, struct iovec *iov, int cnt) {
+    ssize_t n = 0;
+
+    while (cnt > 0) {
+        n = writev(fd, iov, cnt);
+        if (n < 0) {
+            if ((errno == EINTR) || ((errno == EAGAIN) && (codec_out_wait(fd) == 0))) {
+                continue;
+            }
+            return -1;
+        }
+        /* Drop the entries written in full and advance into a partial one. */
+        while ((cnt > 0) && ((size_t)n >= iov->iov_len)) {
+            n -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+/* Advances *done as pages are handed to the pipe, -1 leaves the rest to the caller. */
+static int32_t codec_out_splice(int fd, const uint8_t *buf, size_t len, size_t *done) {
+    struct iovec iov;
+    ssize_t n = 0;
+
+    while (*done < len) {
+        iov.iov_base = (void *)(buf + *done);
+        iov.iov_len = len - *done;
+        n = vmsplice(fd, &iov, 1, 0);
+        if (n < 0) {
+            if ((errno == EINTR) || ((errno == EAGAIN) && (codec_out_wait(fd) == 0))) {
+                continue;
+            }
+            return -1;
+        }
+        *done += n;
+    }
+    return 0;
+}
+
+int32_t codec_out_write(int fd, const void *buf, size_t len, bool newline, bool stable) {
+    static const char nl = '\n';
+    struct iovec iov[2];
+    size_t done = 0;
+    int cnt = 0;
+
+    if (codec_out_kind(fd) == CODEC_OUT_PIPE) {
+        codec_out_grow(fd, len + newline);
+        if (stable && (len >= CODEC_OUT_SPLICE_MIN) && (codec_out_splice(fd, buf, len, &done) != 0)) {
+            if (errno == EPIPE) {
+                return -1;
+            }
+            PRINT_DEBUG("vmsplice failed: %s, copying the rest!", strerror(errno));
+        }
+    }
+
+    if (done < len) {
+        iov[cnt].iov_base = (uint8_t *)buf + done;
+        iov[cnt].iov_len = len - done;
+        cnt++;
+    }
+    if (newline) {
+        iov[cnt].iov_base = (void *)&nl;
+        iov[cnt].iov_len = 1;
+        cnt++;
+    }
+    return codec_out_writev(fd, iov, cnt);
+}
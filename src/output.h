@@ -0,0 +1,38 @@
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Unbuffered output backend for results that already sit in page aligned
+ * codec buffers.  Nothing goes through stdio: a result and its trailing
+ * newline leave in one writev(), and into a pipe whose buffer is stable
+ * (never written again, only unmapped) the pages are handed over with
+ * vmsplice() instead of being copied.  Pipes are grown up to
+ * CODEC_OUT_PIPE_SIZE first so a reader drains large blocks per wakeup.
+ */
+#define CODEC_OUT_PIPE_SIZE (1024 * 1024)
+
+enum codec_out_kind {
+    CODEC_OUT_FILE,
+    CODEC_OUT_TTY,
+    CODEC_OUT_PIPE,
+    CODEC_OUT_SOCKET,
+};
+
+enum codec_out_kind codec_out_kind(int fd);
+const char *codec_out_name(enum codec_out_kind kind);
+
+/*
+ * Writes len bytes of buf to fd, then '\n' if newline.  stable allows
+ * vmsplice(): the pipe keeps referencing the pages after the call returns,
+ * so the caller must not modify buf afterwards, freeing it is fine.
+ */
+int32_t codec_out_write(int fd, const void *buf, size_t len, bool newline, bool stable);
+
+#endif
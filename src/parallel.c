@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "buffer.h"
+#include "compact.h"
+#include "parallel.h"
+
+#define CODEC_MAX_THREADS (256)
+
+enum codec_phase {
+    CODEC_PHASE_LOAD,    /* pread() the input only. */
+    CODEC_PHASE_COUNT,   /* pread() if still needed, count whitespace per chunk. */
+    CODEC_PHASE_COMPACT, /* Strip whitespace of each chunk into its prefix-summed dense offset. */
+    CODEC_PHASE_CODEC,   /* pread() if still needed, then encode/decode. */
+};
+
+struct codec_work {
+    struct codec_job *job;
+    enum codec_phase phase;
+    const uint8_t *src; /* Codec input, job->input or the dense copy. */
+    size_t srclen;
+    size_t in_chunk;
+    size_t out_chunk;
+    size_t nchunks;
+    size_t next; /* Next unclaimed chunk, atomic. */
+    int32_t failed;
+    size_t last_out;
+
+    size_t *spaces; /* COUNT: whitespace per chunk, then dense offset of each chunk. */
+    uint8_t *dense;
+};
+
+static int32_t codec_pread(int fd, uint8_t *buf, size_t len, off_t offset) {
+    ssize_t rsize = 0;
+
+    while (len > 0) {
+        rsize = pread(fd, buf, len, offset);
+        if (rsize < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return -1;
+        }
+        if (rsize == 0) {
+            return -1;
+        }
+        buf += rsize;
+        len -= rsize;
+        offset += rsize;
+    }
+    return 0;
+}
+
+static int32_t codec_work_chunk(struct codec_work *work, size_t i) {
+    struct codec_job *job = work->job;
+    const struct codec_ops *ops = job->ops;
+    bool last = (i == work->nchunks - 1);
+    size_t in_off = i * work->in_chunk;
+    size_t in_len = last ? work->srclen - in_off : work->in_chunk;
+    const uint8_t *src = work->src + in_off;
+    size_t out_off = i * work->out_chunk;
+    size_t out_cap = last ? job->outsize - out_off : work->out_chunk;
+    uint8_t tail[CODEC_STREAM_CARRY * 2] = {0};
+    int32_t node = codec_buf_node();
+    int32_t ret = 0;
+
+    if (job->fd >= 0) {
+        codec_buf_bind(job->input + in_off, in_len, node);
+        if (codec_pread(job->fd, job->input + in_off, in_len, in_off) != 0) {
+            return -1;
+        }
+    }
+    switch (work->phase) {
+        case CODEC_PHASE_LOAD:
+            return 0;
+        case CODEC_PHASE_COUNT:
+            work->spaces[i] = codec_space_count(src, in_len);
+            return 0;
+        case CODEC_PHASE_COMPACT:
+            /* spaces[i] now is the dense offset, spaces[i + 1] the next one. */
+            codec_space_strip(work->dense + work->spaces[i], work->spaces[i + 1] - work->spaces[i], src, in_len);
+            return 0;
+        case CODEC_PHASE_CODEC:
+            break;
+    }
+    codec_buf_bind(job->output + out_off, out_cap, node);
+
+    if (job->is_decode) {
+        ret = ops->decode(src, in_len, job->output + out_off, out_cap);
+        if ((ret < 0) || (!last && ret != work->out_chunk)) {
+            return -1;
+        }
+    } else if (last) {
+        ret = ops->encode(src, in_len, job->output + out_off, out_cap);
+        if (ret < 0) {
+            return -1;
+        }
+    } else {
+        /*
+         * The encoders '\0' terminate, which would land on the first byte of
+         * the next chunk.  Encode the last group separately and copy it in.
+         */
+        ret = ops->encode(src, in_len - ops->enc_block, job->output + out_off, out_cap);
+        if (ret < 0) {
+            return -1;
+        }
+        if (ops->encode(src + in_len - ops->enc_block, ops->enc_block, tail, sizeof(tail)) < 0) {
+            return -1;
+        }
+        memcpy(job->output + out_off + out_cap - ops->dec_block, tail, ops->dec_block);
+    }
+    if (last) {
+        work->last_out = ret;
+    }
+    return 0;
+}
+
+static void *codec_worker(void *arg) {
+    struct codec_work *work = arg;
+    size_t i = 0;
+
+    while (!__atomic_load_n(&work->failed, __ATOMIC_RELAXED)) {
+        i = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED);
+        if (i >= work->nchunks) {
+            break;
+        }
+        if (codec_work_chunk(work, i) != 0) {
+            __atomic_store_n(&work->failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+static int32_t codec_work_run(struct codec_work *work, uint32_t threads) {
+    pthread_t tids[CODEC_MAX_THREADS];
+    uint32_t i = 0, started = 0;
+
+    if (threads > work->nchunks) {
+        threads = work->nchunks;
+    }
+    /* The calling thread is worker 0. */
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(&tids[started], NULL, codec_worker, work) != 0) {
+            break;
+        }
+        started++;
+    }
+    codec_worker(work);
+    for (i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    return work->failed ? -1 : 0;
+}
+
+static uint32_t codec_job_threads(const struct codec_job *job) {
+    long cpus = 0;
+
+    if (job->threads > 0) {
+        return (job->threads > CODEC_MAX_THREADS) ? CODEC_MAX_THREADS : job->threads;
+    }
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus <= 0) {
+        return 1;
+    }
+    return (cpus > CODEC_MAX_THREADS) ? CODEC_MAX_THREADS : cpus;
+}
+
+static void codec_work_init(struct codec_work *work, struct codec_job *job, enum codec_phase phase,
+                            const uint8_t *src, size_t srclen) {
+    const struct codec_ops *ops = job->ops;
+
+    memset(work, 0, sizeof(*work));
+    work->job = job;
+    work->phase = phase;
+    work->src = src;
+    work->srclen = srclen;
+    if (job->is_decode) {
+        work->in_chunk = ops->dec_block * CODEC_HUGE_PAGE;
+        work->out_chunk = ops->enc_block * CODEC_HUGE_PAGE;
+    } else {
+        work->in_chunk = ops->enc_block * CODEC_HUGE_PAGE;
+        work->out_chunk = ops->dec_block * CODEC_HUGE_PAGE;
+    }
+    /* Variable sized groups can't be split at fixed offsets. */
+    if ((phase == CODEC_PHASE_CODEC) && (job->is_decode ? (ops->dec_split != NULL) : ops->enc_var)) {
+        work->in_chunk = (srclen > 0) ? srclen : 1;
+        work->out_chunk = job->outsize;
+    }
+    work->nchunks = (srclen + work->in_chunk - 1) / work->in_chunk;
+    if (work->nchunks == 0) {
+        work->nchunks = 1;
+    }
+}
+
+int32_t codec_job_load(struct codec_job *job) {
+    struct codec_work work;
+
+    if (job->fd < 0) {
+        return 0;
+    }
+    codec_work_init(&work, job, CODEC_PHASE_LOAD, job->input, job->inlen);
+    if (codec_work_run(&work, codec_job_threads(job)) != 0) {
+        return -1;
+    }
+    job->fd = -1;
+    return 0;
+}
+
+/*
+ * Decoders are split at fixed offsets, which only works on dense input.
+ * Count the whitespace of every chunk in parallel, prefix-sum the counts
+ * into dense offsets and let every chunk strip itself into its place.
+ * *dense stays NULL, with *denselen = inlen, if there was no whitespace.
+ */
+static int32_t codec_job_compact(struct codec_job *job, uint32_t threads, uint8_t **dense, size_t *denselen) {
+    struct codec_work work;
+    size_t i = 0, off = 0, spaces = 0;
+    int32_t ret = -1;
+
+    *dense = NULL;
+    *denselen = job->inlen;
+
+    codec_work_init(&work, job, CODEC_PHASE_COUNT, job->input, job->inlen);
+    work.spaces = calloc(work.nchunks + 1, sizeof(*work.spaces));
+    if (work.spaces == NULL) {
+        return -1;
+    }
+    if (codec_work_run(&work, threads) != 0) {
+        goto err;
+    }
+    job->fd = -1;
+
+    for (i = 0; i < work.nchunks; i++) {
+        spaces = work.spaces[i];
+        work.spaces[i] = off;
+        off += ((i == work.nchunks - 1) ? job->inlen - i * work.in_chunk : work.in_chunk) - spaces;
+    }
+    work.spaces[work.nchunks] = off;
+    if (off == job->inlen) {
+        ret = 0;
+        goto err;
+    }
+
+    work.dense = codec_buf_alloc(off + 1);
+    if ((off > 0) && (work.dense == NULL)) {
+        goto err;
+    }
+    work.phase = CODEC_PHASE_COMPACT;
+    work.next = 0;
+    if (codec_work_run(&work, threads) != 0) {
+        codec_buf_free(work.dense, off + 1);
+        goto err;
+    }
+    *dense = work.dense;
+    *denselen = off;
+    ret = 0;
+err:
+    free(work.spaces);
+    return ret;
+}
+
+int32_t codec_job_run(struct codec_job *job) {
+    struct codec_work work;
+    uint32_t threads = codec_job_threads(job);
+    uint8_t *dense = NULL;
+    size_t denselen = job->inlen;
+    int32_t ret = 0;
+
+    if (job->is_decode && (codec_job_compact(job, threads, &dense, &denselen) != 0)) {
+        return -1;
+    }
+
+    codec_work_init(&work, job, CODEC_PHASE_CODEC, (dense != NULL) ? dense : job->input, denselen);
+    ret = codec_work_run(&work, threads);
+    if (ret == 0) {
+        job->fd = -1;
+        job->outlen = (work.nchunks - 1) * work.out_chunk + work.last_out;
+    }
+    codec_buf_free(dense, denselen + 1);
+    return ret;
+}
@@ -0,0 +1,39 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "codec.h"
+
+/*
+ * One encode or decode over a whole payload, split into chunks that are a
+ * whole number of groups and CODEC_HUGE_PAGE aligned on both sides.  Every
+ * chunk goes through one call of ops->encode/ops->decode, so the 32-bit
+ * return values never limit the payload size.
+ *
+ * With fd >= 0 the workers pread() their own input chunks, after binding
+ * the chunk's input and output pages to the NUMA node they run on.
+ */
+struct codec_job {
+    const struct codec_ops *ops;
+    bool is_decode;
+    uint32_t threads; /* 0 for one per online CPU. */
+
+    int fd; /* Input still to be read, -1 once input holds the data. */
+    uint8_t *input;
+    size_t inlen;
+
+    uint8_t *output;
+    size_t outsize; /* Capacity of output. */
+    size_t outlen;  /* Bytes stored by codec_job_run(). */
+};
+
+int32_t codec_job_load(struct codec_job *job);
+int32_t codec_job_run(struct codec_job *job);
+
+#endif
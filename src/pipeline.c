@@ -0,0 +1,555 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef CODEC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CODEC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "log.h"
+#include "buffer.h"
+#include "pipeline.h"
+#include "output.h"
+
+#define CODEC_PIPE_MAX_STAGES (4)
+
+/* Bounded ring of blocks between two neighbouring stages. */
+struct codec_pipe_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t *mem;
+    size_t cap; /* Bytes per block. */
+    size_t len[CODEC_PIPE_DEPTH];
+    bool last[CODEC_PIPE_DEPTH];
+    uint32_t head; /* Blocks filled by the producer. */
+    uint32_t tail; /* Blocks released by the consumer. */
+    bool aborted;
+};
+
+struct codec_pipe_ctx;
+
+struct codec_pipe_stage {
+    struct codec_pipe_ctx *ctx;
+    struct codec_pipe_queue *in;  /* NULL for the reader. */
+    struct codec_pipe_queue *out; /* NULL for the writer. */
+    int32_t (*run)(struct codec_pipe_stage *st);
+    int32_t ret;
+};
+
+struct codec_pipe_ctx {
+    struct codec_pipeline *pl;
+    struct codec_pipe_stage stages[CODEC_PIPE_MAX_STAGES];
+    struct codec_pipe_queue queues[CODEC_PIPE_MAX_STAGES - 1];
+    uint32_t nstages;
+    uint32_t nqueues;
+};
+
+static int32_t codec_pipe_queue_init(struct codec_pipe_queue *q, size_t cap) {
+    memset(q, 0, sizeof(*q));
+    q->cap = cap;
+    q->mem = codec_buf_alloc(cap * CODEC_PIPE_DEPTH);
+    if (q->mem == NULL) {
+        return -1;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    return 0;
+}
+
+static void codec_pipe_queue_free(struct codec_pipe_queue *q) {
+    codec_buf_free(q->mem, q->cap * CODEC_PIPE_DEPTH);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->cond);
+}
+
+/* Producer side: the next empty block, NULL once the pipeline is aborted. */
+static uint8_t *codec_pipe_get(struct codec_pipe_queue *q) {
+    uint8_t *blk = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (!q->aborted && (q->head - q->tail == CODEC_PIPE_DEPTH)) {
+        pthread_cond_wait(&q->cond, &q->lock);
+    }
+    if (!q->aborted) {
+        blk = q->mem + (q->head % CODEC_PIPE_DEPTH) * q->cap;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return blk;
+}
+
+static void codec_pipe_put(struct codec_pipe_queue *q, size_t len, bool last) {
+    pthread_mutex_lock(&q->lock);
+    q->len[q->head % CODEC_PIPE_DEPTH] = len;
+    q->last[q->head % CODEC_PIPE_DEPTH] = last;
+    q->head++;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* Consumer side: the oldest filled block, NULL once the pipeline is aborted. */
+static const uint8_t *codec_pipe_peek(struct codec_pipe_queue *q, size_t *len, bool *last) {
+    const uint8_t *blk = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (!q->aborted && (q->head == q->tail)) {
+        pthread_cond_wait(&q->cond, &q->lock);
+    }
+    if (!q->aborted) {
+        blk = q->mem + (q->tail % CODEC_PIPE_DEPTH) * q->cap;
+        *len = q->len[q->tail % CODEC_PIPE_DEPTH];
+        *last = q->last[q->tail % CODEC_PIPE_DEPTH];
+    }
+    pthread_mutex_unlock(&q->lock);
+    return blk;
+}
+
+static void codec_pipe_pop(struct codec_pipe_queue *q) {
+    pthread_mutex_lock(&q->lock);
+    q->tail++;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* Wakes every stage blocked on a queue, they all bail out. */
+static void codec_pipe_abort(struct codec_pipe_ctx *ctx) {
+    uint32_t i = 0;
+
+    for (i = 0; i < ctx->nqueues; i++) {
+        pthread_mutex_lock(&ctx->queues[i].lock);
+        ctx->queues[i].aborted = true;
+        pthread_cond_broadcast(&ctx->queues[i].cond);
+        pthread_mutex_unlock(&ctx->queues[i].lock);
+    }
+}
+
+static int32_t codec_pipe_read(struct codec_pipe_stage *st) {
+    struct codec_pipeline *pl = st->ctx->pl;
+    size_t cap = st->out->cap, off = 0, len = 0;
+    uint8_t *blk = NULL;
+    ssize_t n = 0;
+    bool eof = false;
+
+    while (!eof) {
+        blk = codec_pipe_get(st->out);
+        if (blk == NULL) {
+            return -1;
+        }
+        if (pl->in_fd < 0) {
+            len = (pl->inlen - off < cap) ? pl->inlen - off : cap;
+            memcpy(blk, pl->input + off, len);
+            off += len;
+            eof = (off == pl->inlen);
+        } else {
+            for (len = 0; len < cap; len += n) {
+                n = read(pl->in_fd, blk + len, cap - len);
+                if ((n < 0) && (errno == EINTR)) {
+                    n = 0;
+                    continue;
+                }
+                if (n < 0) {
+                    PRINT_ERROR("Failed to read input: %s!", strerror(errno));
+                    return -1;
+                }
+                if (n == 0) {
+                    eof = true;
+                    break;
+                }
+            }
+        }
+        codec_pipe_put(st->out, len, eof);
+    }
+    return 0;
+}
+
+static int32_t codec_pipe_write(struct codec_pipe_stage *st) {
+    struct codec_pipeline *pl = st->ctx->pl;
+    const uint8_t *blk = NULL;
+    size_t len = 0;
+    bool last = false;
+
+    while (!last) {
+        blk = codec_pipe_peek(st->in, &len, &last);
+        if (blk == NULL) {
+            return -1;
+        }
+        /* Not stable, the block is refilled as soon as it is popped. */
+        if (codec_out_write(pl->out_fd, blk, len, false, false) != 0) {
+            PRINT_ERROR("Failed to write output: %s!", strerror(errno));
+            return -1;
+        }
+        pl->outlen += len;
+        codec_pipe_pop(st->in);
+    }
+    return 0;
+}
+
+/* Output blocks are sized by encode_len/decode_len, one update always fits. */
+static int32_t codec_pipe_codec(struct codec_pipe_stage *st) {
+    struct codec_pipeline *pl = st->ctx->pl;
+    struct codec_stream ctx;
+    const uint8_t *in = NULL;
+    uint8_t *out = NULL;
+    size_t len = 0;
+    bool last = false;
+    int32_t ret = 0;
+
+    codec_stream_init(&ctx, pl->ops, pl->is_decode);
+    while (!last) {
+        in = codec_pipe_peek(st->in, &len, &last);
+        out = codec_pipe_get(st->out);
+        if ((in == NULL) || (out == NULL)) {
+            return -1;
+        }
+        ret = codec_stream_update(&ctx, in, len, out, st->out->cap);
+        codec_pipe_pop(st->in);
+        if (ret < 0) {
+            goto err;
+        }
+        codec_pipe_put(st->out, ret, false);
+    }
+
+    out = codec_pipe_get(st->out);
+    if (out == NULL) {
+        return -1;
+    }
+    ret = codec_stream_final(&ctx, out, st->out->cap);
+    if (ret < 0) {
+        goto err;
+    }
+    codec_pipe_put(st->out, ret, true);
+    return 0;
+
+err:
+    PRINT_ERROR("%s %s failed!", pl->ops->name, pl->is_decode ? "decode" : "encode");
+    return -1;
+}
+
+/*
+ * One (de)compressor, driven like deflate()/inflate(): step consumes what
+ * it can of in, produces what fits into out and returns 1 once the stream
+ * is complete (compression flushed its end, decompression reached the end
+ * of a member or frame), 0 if it needs more calls and -1 on error.
+ */
+struct codec_pipe_z {
+    bool compress;
+    bool ended;
+#ifdef CODEC_HAVE_ZLIB
+    z_stream zs;
+#endif
+#ifdef CODEC_HAVE_ZSTD
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+#endif
+    int32_t (*step)(struct codec_pipe_z *z, const uint8_t *in, size_t inlen, size_t *used, uint8_t *out,
+                    size_t outcap, size_t *made, bool finish);
+    void (*end)(struct codec_pipe_z *z);
+};
+
+#ifdef CODEC_HAVE_ZLIB
+static int32_t codec_gzip_step(struct codec_pipe_z *z, const uint8_t *in, size_t inlen, size_t *used, uint8_t *out,
+                               size_t outcap, size_t *made, bool finish) {
+    int ret = 0;
+
+    /* Another gzip member follows the one that ended. */
+    if (!z->compress && z->ended) {
+        if (inflateReset(&z->zs) != Z_OK) {
+            return -1;
+        }
+        z->ended = false;
+    }
+    z->zs.next_in = (Bytef *)in;
+    z->zs.avail_in = inlen;
+    z->zs.next_out = out;
+    z->zs.avail_out = outcap;
+    ret = z->compress ? deflate(&z->zs, finish ? Z_FINISH : Z_NO_FLUSH) : inflate(&z->zs, Z_NO_FLUSH);
+    *used = inlen - z->zs.avail_in;
+    *made = outcap - z->zs.avail_out;
+
+    if (ret == Z_STREAM_END) {
+        z->ended = true;
+        return 1;
+    }
+    if ((ret == Z_OK) || (ret == Z_BUF_ERROR)) {
+        return 0;
+    }
+    PRINT_ERROR("gzip: %s!", (z->zs.msg != NULL) ? z->zs.msg : "stream error");
+    return -1;
+}
+
+static void codec_gzip_end(struct codec_pipe_z *z) {
+    if (z->compress) {
+        deflateEnd(&z->zs);
+    } else {
+        inflateEnd(&z->zs);
+    }
+}
+#endif
+
+#ifdef CODEC_HAVE_ZSTD
+static int32_t codec_zstd_step(struct codec_pipe_z *z, const uint8_t *in, size_t inlen, size_t *used, uint8_t *out,
+                               size_t outcap, size_t *made, bool finish) {
+    ZSTD_inBuffer ib = {in, inlen, 0};
+    ZSTD_outBuffer ob = {out, outcap, 0};
+    size_t ret = 0;
+
+    if (z->compress) {
+        ret = ZSTD_compressStream2(z->cctx, &ob, &ib, finish ? ZSTD_e_end : ZSTD_e_continue);
+    } else {
+        /* A frame that follows the one that ended starts by itself. */
+        ret = ZSTD_decompressStream(z->dctx, &ob, &ib);
+    }
+    if (ZSTD_isError(ret)) {
+        PRINT_ERROR("zstd: %s!", ZSTD_getErrorName(ret));
+        return -1;
+    }
+    *used = ib.pos;
+    *made = ob.pos;
+
+    /* Both return 0 once everything is flushed. */
+    z->ended = (ret == 0) && (finish || !z->compress);
+    return z->ended ? 1 : 0;
+}
+
+static void codec_zstd_end(struct codec_pipe_z *z) {
+    ZSTD_freeCCtx(z->cctx);
+    ZSTD_freeDCtx(z->dctx);
+}
+#endif
+
+static int32_t codec_pipe_z_init(struct codec_pipe_z *z, enum codec_pipe_comp comp, bool compress, int32_t level) {
+    memset(z, 0, sizeof(*z));
+    z->compress = compress;
+
+    switch (comp) {
+#ifdef CODEC_HAVE_ZLIB
+        case CODEC_PIPE_GZIP:
+            /* 16 + 15 writes a gzip wrapper, 32 + 15 reads gzip or zlib. */
+            if ((compress ? deflateInit2(&z->zs, (level != 0) ? level : Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + 15, 8,
+                                         Z_DEFAULT_STRATEGY)
+                          : inflateInit2(&z->zs, 32 + 15)) != Z_OK) {
+                PRINT_ERROR("gzip: failed to init, level [%d]!", level);
+                return -1;
+            }
+            z->step = codec_gzip_step;
+            z->end = codec_gzip_end;
+            return 0;
+#endif
+#ifdef CODEC_HAVE_ZSTD
+        case CODEC_PIPE_ZSTD:
+            if (compress) {
+                z->cctx = ZSTD_createCCtx();
+                if ((z->cctx == NULL) ||
+                    ((level != 0) && ZSTD_isError(ZSTD_CCtx_setParameter(z->cctx, ZSTD_c_compressionLevel, level)))) {
+                    PRINT_ERROR("zstd: failed to init, level [%d]!", level);
+                    ZSTD_freeCCtx(z->cctx);
+                    return -1;
+                }
+            } else {
+                z->dctx = ZSTD_createDCtx();
+                if (z->dctx == NULL) {
+                    return -1;
+                }
+            }
+            z->step = codec_zstd_step;
+            z->end = codec_zstd_end;
+            return 0;
+#endif
+        default:
+            (void)level;
+            return -1;
+    }
+}
+
+static int32_t codec_pipe_zstage(struct codec_pipe_stage *st) {
+    struct codec_pipeline *pl = st->ctx->pl;
+    struct codec_pipe_z z;
+    size_t cap = st->out->cap, len = 0, pos = 0, olen = 0, used = 0, made = 0;
+    const uint8_t *in = NULL;
+    uint8_t *out = NULL;
+    bool last = false;
+    int32_t ret = -1;
+
+    if (codec_pipe_z_init(&z, pl->comp, !pl->is_decode, pl->level) != 0) {
+        return -1;
+    }
+
+    while (!last) {
+        in = codec_pipe_peek(st->in, &len, &last);
+        if (in == NULL) {
+            ret = -1;
+            goto err;
+        }
+        /* The last block is only done once the stream has ended. */
+        for (pos = 0; (pos < len) || (last && !z.ended);) {
+            if (out == NULL) {
+                out = codec_pipe_get(st->out);
+                if (out == NULL) {
+                    ret = -1;
+                    goto err;
+                }
+                olen = 0;
+            }
+            ret = z.step(&z, in + pos, len - pos, &used, out + olen, cap - olen, &made, last);
+            if (ret < 0) {
+                goto err;
+            }
+            if ((ret == 0) && (used == 0) && (made == 0)) {
+                PRINT_ERROR("%s stream is truncated!", codec_pipe_name(pl->comp));
+                ret = -1;
+                goto err;
+            }
+            pos += used;
+            olen += made;
+            if (olen == cap) {
+                codec_pipe_put(st->out, olen, false);
+                out = NULL;
+            }
+        }
+        codec_pipe_pop(st->in);
+    }
+
+    if (out == NULL) {
+        out = codec_pipe_get(st->out);
+        olen = 0;
+    }
+    if (out == NULL) {
+        ret = -1;
+        goto err;
+    }
+    codec_pipe_put(st->out, olen, true);
+    ret = 0;
+
+err:
+    z.end(&z);
+    return ret;
+}
+
+bool codec_pipe_supported(enum codec_pipe_comp comp) {
+    switch (comp) {
+        case CODEC_PIPE_NONE:
+            return true;
+#ifdef CODEC_HAVE_ZLIB
+        case CODEC_PIPE_GZIP:
+            return true;
+#endif
+#ifdef CODEC_HAVE_ZSTD
+        case CODEC_PIPE_ZSTD:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+const char *codec_pipe_name(enum codec_pipe_comp comp) {
+    switch (comp) {
+        case CODEC_PIPE_GZIP:
+            return "gzip";
+        case CODEC_PIPE_ZSTD:
+            return "zstd";
+        default:
+            return "none";
+    }
+}
+
+/* Appends a stage; outcap is the block size of its output queue, 0 for the writer. */
+static int32_t codec_pipe_add(struct codec_pipe_ctx *ctx, int32_t (*run)(struct codec_pipe_stage *st), size_t outcap) {
+    struct codec_pipe_stage *st = &ctx->stages[ctx->nstages];
+
+    st->ctx = ctx;
+    st->run = run;
+    st->in = (ctx->nstages > 0) ? &ctx->queues[ctx->nstages - 1] : NULL;
+    if (outcap > 0) {
+        if (codec_pipe_queue_init(&ctx->queues[ctx->nqueues], outcap) != 0) {
+            PRINT_ERROR("Failed to malloc!");
+            return -1;
+        }
+        st->out = &ctx->queues[ctx->nqueues++];
+    }
+    ctx->nstages++;
+    return 0;
+}
+
+static void *codec_pipe_thread(void *arg) {
+    struct codec_pipe_stage *st = arg;
+
+    st->ret = st->run(st);
+    if (st->ret != 0) {
+        codec_pipe_abort(st->ctx);
+    }
+    return NULL;
+}
+
+int32_t codec_pipe_run(struct codec_pipeline *pl) {
+    struct codec_pipe_ctx ctx;
+    pthread_t tids[CODEC_PIPE_MAX_STAGES];
+    const struct codec_ops *ops = pl->ops;
+    size_t codec_cap = 0;
+    uint32_t i = 0, started = 0;
+    int32_t ret = -1;
+
+    if (!codec_pipe_supported(pl->comp)) {
+        PRINT_ERROR("Built without %s support!", codec_pipe_name(pl->comp));
+        return -1;
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.pl = pl;
+    pl->outlen = 0;
+    codec_cap = pl->is_decode ? ops->decode_len(CODEC_PIPE_BLOCK + CODEC_STREAM_CARRY)
+                              : ops->encode_len(CODEC_PIPE_BLOCK + CODEC_STREAM_CARRY);
+
+    if (codec_pipe_add(&ctx, codec_pipe_read, CODEC_PIPE_BLOCK) != 0) {
+        goto err;
+    }
+    if (!pl->is_decode && (pl->comp != CODEC_PIPE_NONE) &&
+        (codec_pipe_add(&ctx, codec_pipe_zstage, CODEC_PIPE_BLOCK) != 0)) {
+        goto err;
+    }
+    if (codec_pipe_add(&ctx, codec_pipe_codec, codec_cap) != 0) {
+        goto err;
+    }
+    if (pl->is_decode && (pl->comp != CODEC_PIPE_NONE) &&
+        (codec_pipe_add(&ctx, codec_pipe_zstage, CODEC_PIPE_BLOCK) != 0)) {
+        goto err;
+    }
+    if (codec_pipe_add(&ctx, codec_pipe_write, 0) != 0) {
+        goto err;
+    }
+
+    /* The calling thread runs the writer. */
+    for (i = 0; i + 1 < ctx.nstages; i++) {
+        if (pthread_create(&tids[started], NULL, codec_pipe_thread, &ctx.stages[i]) != 0) {
+            PRINT_ERROR("Failed to start pipeline thread!");
+            ctx.stages[i].ret = -1;
+            codec_pipe_abort(&ctx);
+            break;
+        }
+        started++;
+    }
+    codec_pipe_thread(&ctx.stages[ctx.nstages - 1]);
+    for (i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    ret = 0;
+    for (i = 0; i < ctx.nstages; i++) {
+        if (ctx.stages[i].ret != 0) {
+            ret = -1;
+        }
+    }
+
+err:
+    for (i = 0; i < ctx.nqueues; i++) {
+        codec_pipe_queue_free(&ctx.queues[i]);
+    }
+    return ret;
+}
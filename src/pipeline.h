@@ -0,0 +1,56 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "codec.h"
+
+/*
+ * Streaming pipeline with an optional compression stage in front of the
+ * encoder or behind the decoder:
+ *
+ *   encode: read -> compress -> encode -> write
+ *   decode: read -> decode -> decompress -> write
+ *
+ * Every stage runs on its own thread and hands CODEC_PIPE_BLOCK sized
+ * blocks to the next one through a bounded ring of CODEC_PIPE_DEPTH
+ * blocks, so the stages overlap and the whole pipeline runs at the speed of
+ * its slowest stage.  Neither the compressed nor the full payload is ever
+ * held in memory.  Decompression accepts concatenated gzip members or zstd
+ * frames; gzip decode also takes zlib streams.
+ */
+#define CODEC_PIPE_BLOCK (1024 * 1024)
+#define CODEC_PIPE_DEPTH (4)
+
+enum codec_pipe_comp {
+    CODEC_PIPE_NONE,
+    CODEC_PIPE_GZIP,
+    CODEC_PIPE_ZSTD,
+};
+
+struct codec_pipeline {
+    const struct codec_ops *ops;
+    bool is_decode;
+    enum codec_pipe_comp comp;
+    int32_t level; /* Compression level, 0 for the library default. */
+
+    int in_fd; /* Read until end of file, or -1 to take input/inlen. */
+    const uint8_t *input;
+    size_t inlen;
+
+    int out_fd;
+    size_t outlen; /* Bytes written to out_fd by codec_pipe_run(). */
+};
+
+/* false if the library for comp was not found at build time. */
+bool codec_pipe_supported(enum codec_pipe_comp comp);
+const char *codec_pipe_name(enum codec_pipe_comp comp);
+
+int32_t codec_pipe_run(struct codec_pipeline *pl);
+
+#endif
@@ -0,0 +1,411 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/futex.h>
+
+#include "log.h"
+#include "daemon.h"
+#include "shmring.h"
+
+#define CODEC_RING_SPIN (4096)
+#define CODEC_RING_NAP_MS (100)
+#define CODEC_RING_MAX_DATA (256U * 1024 * 1024)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define codec_cpu_relax() __builtin_ia32_pause()
+#else
+#define codec_cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+static void codec_futex_wait(uint32_t *addr, uint32_t val) {
+    struct timespec ts = {0, CODEC_RING_NAP_MS * 1000000L};
+
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void codec_futex_wake(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/* True once the peer closed its end of the control socket. */
+static bool codec_sock_closed(int sock) {
+    char c = 0;
+    ssize_t ret = recv(sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+    return (ret == 0) || ((ret < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR));
+}
+
+static size_t codec_ring_align(size_t len) {
+    return (len + 63) & ~(size_t)63;
+}
+
+/* Client side, the layout in the header was written by the server. */
+static struct codec_ring_slot *codec_ring_slots(struct codec_ring_hdr *hdr) {
+    return (struct codec_ring_slot *)((uint8_t *)hdr + hdr->slot_off);
+}
+
+static uint8_t *codec_ring_data(struct codec_ring_hdr *hdr, uint32_t idx) {
+    return (uint8_t *)hdr + hdr->data_off + (size_t)idx * (hdr->in_size + hdr->out_size);
+}
+
+/*
+ * The server's copy of the layout it created.  The header in the mapping is
+ * writable by the client, so the server never reads the layout back from it.
+ */
+struct codec_ring_layout {
+    uint8_t *base;
+    uint32_t slots;
+    size_t in_size;
+    size_t out_size;
+    size_t slot_off;
+    size_t data_off;
+};
+
+static int32_t codec_ring_check(const struct codec_ring_cfg *cfg) {
+    if ((cfg->slots == 0) || (cfg->slots > CODEC_RING_MAX_SLOTS) || (cfg->slots & (cfg->slots - 1)) ||
+        (cfg->slot_size == 0) || (cfg->slot_size > CODEC_RING_MAX_SLOT_SIZE) ||
+        ((uint64_t)cfg->slots * cfg->slot_size > CODEC_RING_MAX_DATA)) {
+        return -1;
+    }
+    return 0;
+}
+
+static void codec_ring_process(const struct codec_ring_layout *lay, uint32_t idx) {
+    struct codec_ring_slot *slot = (struct codec_ring_slot *)(lay->base + lay->slot_off) + idx;
+    uint8_t *in = lay->base + lay->data_off + (size_t)idx * (lay->in_size + lay->out_size);
+    uint8_t *out = in + lay->in_size;
+    /* Read every request field exactly once, the client may rewrite them at any time. */
+    uint8_t codec = __atomic_load_n(&slot->codec, __ATOMIC_RELAXED);
+    uint8_t op = __atomic_load_n(&slot->op, __ATOMIC_RELAXED);
+    uint32_t in_len = __atomic_load_n(&slot->in_len, __ATOMIC_RELAXED);
+    const struct codec_ops *ops = codec_by_id(codec);
+    size_t need = 0;
+    int32_t ret = -1;
+
+    if ((ops != NULL) && (op <= CODEC_OP_DECODE) && (in_len <= lay->in_size)) {
+        need = (op == CODEC_OP_DECODE) ? ops->decode_len(in_len) : ops->encode_len(in_len);
+        if (need <= lay->out_size) {
+            if (op == CODEC_OP_DECODE) {
+                ret = ops->decode(in, in_len, out, lay->out_size);
+            } else {
+                ret = ops->encode(in, in_len, out, lay->out_size);
+            }
+        }
+    }
+    slot->status = (ret < 0) ? -1 : 0;
+    slot->out_len = (ret < 0) ? 0 : ret;
+}
+
+static int32_t codec_ring_send_fd(int sock, int fd) {
+    struct codec_resp_hdr resp;
+    struct iovec iov;
+    struct msghdr msg;
+    struct cmsghdr *cmsg = NULL;
+    char control[CMSG_SPACE(sizeof(int))];
+
+    memset(&resp, 0, sizeof(resp));
+    resp.magic = CODEC_REQ_MAGIC;
+    resp.status = (fd >= 0) ? 0 : -1;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    iov.iov_base = &resp;
+    iov.iov_len = sizeof(resp);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (fd >= 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    return (sendmsg(sock, &msg, MSG_NOSIGNAL) == sizeof(resp)) ? 0 : -1;
+}
+
+static int codec_ring_recv_fd(int sock) {
+    struct codec_resp_hdr resp;
+    struct iovec iov;
+    struct msghdr msg;
+    struct cmsghdr *cmsg = NULL;
+    char control[CMSG_SPACE(sizeof(int))];
+    int fd = -1;
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = &resp;
+    iov.iov_len = sizeof(resp);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != sizeof(resp)) {
+        return -1;
+    }
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if ((cmsg != NULL) && (cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if ((resp.magic != CODEC_REQ_MAGIC) || (resp.status != 0)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+int32_t codec_ring_serve(int sock, const struct codec_ring_cfg *cfg) {
+    struct codec_ring_hdr *hdr = NULL;
+    struct codec_ring_layout lay;
+    size_t slot_off = 0, data_off = 0, in_size = 0, out_size = 0, map_len = 0;
+    uint32_t tail = 0, spins = 0;
+    int fd = -1;
+
+    if (codec_ring_check(cfg) != 0) {
+        codec_ring_send_fd(sock, -1);
+        return -1;
+    }
+    in_size = codec_ring_align(cfg->slot_size);
+    /* Ascii85 decode is the worst case, every 'z' gives 4 bytes. */
+    out_size = codec_ring_align((size_t)cfg->slot_size * 4 + 1);
+    slot_off = codec_ring_align(sizeof(*hdr));
+    data_off = (slot_off + cfg->slots * sizeof(struct codec_ring_slot) + 4095) & ~(size_t)4095;
+    map_len = data_off + cfg->slots * (in_size + out_size);
+
+    /* Sealed so the client can't shrink the file under the server's mapping (SIGBUS). */
+    fd = memfd_create("codec-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if ((fd < 0) || (ftruncate(fd, map_len) != 0) ||
+        (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0)) {
+        goto err;
+    }
+    hdr = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (hdr == MAP_FAILED) {
+        hdr = NULL;
+        goto err;
+    }
+    hdr->magic = CODEC_RING_MAGIC;
+    hdr->slots = cfg->slots;
+    hdr->in_size = in_size;
+    hdr->out_size = out_size;
+    hdr->slot_off = slot_off;
+    hdr->data_off = data_off;
+
+    lay.base = (uint8_t *)hdr;
+    lay.slots = cfg->slots;
+    lay.in_size = in_size;
+    lay.out_size = out_size;
+    lay.slot_off = slot_off;
+    lay.data_off = data_off;
+
+    if (codec_ring_send_fd(sock, fd) != 0) {
+        goto err;
+    }
+    close(fd);
+    fd = -1;
+
+    for (;;) {
+        if (__atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE) != tail) {
+            codec_ring_process(&lay, tail & (lay.slots - 1));
+            tail++;
+            __atomic_store_n(&hdr->done, tail, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&hdr->cli_sleeping, __ATOMIC_SEQ_CST)) {
+                codec_futex_wake(&hdr->done);
+            }
+            spins = 0;
+            continue;
+        }
+        if (__atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        if (++spins < CODEC_RING_SPIN) {
+            codec_cpu_relax();
+            continue;
+        }
+
+        /* Idle, announce the sleep and re-check so a submit can't be missed. */
+        __atomic_store_n(&hdr->srv_sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&hdr->head, __ATOMIC_SEQ_CST) == tail) {
+            codec_futex_wait(&hdr->head, tail);
+        }
+        __atomic_store_n(&hdr->srv_sleeping, 0, __ATOMIC_SEQ_CST);
+        spins = 0;
+        if ((__atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE) == tail) && codec_sock_closed(sock)) {
+            break;
+        }
+    }
+    munmap(hdr, map_len);
+    return 0;
+
+err:
+    PRINT_ERROR("Failed to set up ring [%s]!", strerror(errno));
+    if (hdr != NULL) {
+        munmap(hdr, map_len);
+    } else {
+        codec_ring_send_fd(sock, -1);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return -1;
+}
+
+struct codec_ring *codec_ring_open(const char *path, uint32_t slots, uint32_t slot_size) {
+    struct codec_ring *ring = NULL;
+    struct codec_req_hdr req;
+    struct codec_ring_cfg cfg = {slots, slot_size};
+    struct codec_ring_hdr *hdr = NULL;
+    struct iovec iov[2];
+    struct msghdr msg;
+    size_t map_len = 0;
+    int sock = -1, fd = -1;
+
+    if (codec_ring_check(&cfg) != 0) {
+        return NULL;
+    }
+    sock = codec_client_connect(path);
+    if (sock < 0) {
+        return NULL;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.magic = CODEC_REQ_MAGIC;
+    req.op = CODEC_OP_RING;
+    req.len = sizeof(cfg);
+    memset(&msg, 0, sizeof(msg));
+    iov[0].iov_base = &req;
+    iov[0].iov_len = sizeof(req);
+    iov[1].iov_base = &cfg;
+    iov[1].iov_len = sizeof(cfg);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    if (sendmsg(sock, &msg, MSG_NOSIGNAL) != sizeof(req) + sizeof(cfg)) {
+        goto err;
+    }
+
+    fd = codec_ring_recv_fd(sock);
+    if (fd < 0) {
+        goto err;
+    }
+    hdr = mmap(NULL, sizeof(*hdr), PROT_READ, MAP_SHARED, fd, 0);
+    if (hdr == MAP_FAILED) {
+        goto err;
+    }
+    map_len = hdr->data_off + (size_t)hdr->slots * (hdr->in_size + hdr->out_size);
+    munmap(hdr, sizeof(*hdr));
+    hdr = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if ((hdr == MAP_FAILED) || (hdr->magic != CODEC_RING_MAGIC)) {
+        goto err;
+    }
+    close(fd);
+
+    ring = calloc(1, sizeof(*ring));
+    if (ring == NULL) {
+        munmap(hdr, map_len);
+        close(sock);
+        return NULL;
+    }
+    ring->sock = sock;
+    ring->hdr = hdr;
+    ring->map_len = map_len;
+    return ring;
+
+err:
+    if (fd >= 0) {
+        close(fd);
+    }
+    close(sock);
+    return NULL;
+}
+
+void codec_ring_close(struct codec_ring *ring) {
+    if (ring == NULL) {
+        return;
+    }
+    __atomic_store_n(&ring->hdr->closed, 1, __ATOMIC_SEQ_CST);
+    codec_futex_wake(&ring->hdr->head);
+    munmap(ring->hdr, ring->map_len);
+    close(ring->sock);
+    free(ring);
+}
+
+uint8_t *codec_ring_slot_in(struct codec_ring *ring) {
+    if (ring->submitted - ring->consumed >= ring->hdr->slots) {
+        return NULL;
+    }
+    return codec_ring_data(ring->hdr, ring->submitted & (ring->hdr->slots - 1));
+}
+
+int32_t codec_ring_submit(struct codec_ring *ring, uint8_t codec, bool is_decode, uint32_t len) {
+    struct codec_ring_hdr *hdr = ring->hdr;
+    struct codec_ring_slot *slot = NULL;
+
+    if ((ring->submitted - ring->consumed >= hdr->slots) || (len > hdr->in_size)) {
+        return -1;
+    }
+    slot = &codec_ring_slots(hdr)[ring->submitted & (hdr->slots - 1)];
+    slot->codec = codec;
+    slot->op = is_decode ? CODEC_OP_DECODE : CODEC_OP_ENCODE;
+    slot->in_len = len;
+
+    ring->submitted++;
+    __atomic_store_n(&hdr->head, ring->submitted, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&hdr->srv_sleeping, __ATOMIC_SEQ_CST)) {
+        codec_futex_wake(&hdr->head);
+    }
+    return 0;
+}
+
+int32_t codec_ring_complete(struct codec_ring *ring, const uint8_t **out) {
+    struct codec_ring_hdr *hdr = ring->hdr;
+    struct codec_ring_slot *slot = NULL;
+    uint32_t idx = 0, spins = 0;
+
+    if (ring->holding) {
+        ring->consumed++;
+        ring->holding = false;
+    }
+    if (ring->consumed == ring->submitted) {
+        return -1;
+    }
+
+    while (__atomic_load_n(&hdr->done, __ATOMIC_ACQUIRE) == ring->consumed) {
+        if (++spins < CODEC_RING_SPIN) {
+            codec_cpu_relax();
+            continue;
+        }
+        __atomic_store_n(&hdr->cli_sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&hdr->done, __ATOMIC_SEQ_CST) == ring->consumed) {
+            codec_futex_wait(&hdr->done, ring->consumed);
+        }
+        __atomic_store_n(&hdr->cli_sleeping, 0, __ATOMIC_SEQ_CST);
+        spins = 0;
+        if ((__atomic_load_n(&hdr->done, __ATOMIC_ACQUIRE) == ring->consumed) && codec_sock_closed(ring->sock)) {
+            return -1;
+        }
+    }
+
+    idx = ring->consumed & (hdr->slots - 1);
+    slot = &codec_ring_slots(hdr)[idx];
+    ring->holding = true;
+    if (out != NULL) {
+        *out = codec_ring_data(hdr, idx) + hdr->in_size;
+    }
+    return (slot->status == 0) ? (int32_t)slot->out_len : -1;
+}
+
+uint32_t codec_ring_pending(const struct codec_ring *ring) {
+    return ring->submitted - ring->consumed - (ring->holding ? 1 : 0);
+}
@@ -0,0 +1,89 @@
+#ifndef __SHMRING_H__
+#define __SHMRING_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "codec.h"
+
+/*
+ * Shared memory request ring between one client thread and one server
+ * worker (single producer, single consumer).  The client asks the server
+ * for a ring over the Unix socket (CODEC_OP_RING), the server creates a
+ * memfd, passes it back with SCM_RIGHTS and from then on both sides only
+ * touch the mapping: the client writes input straight into a slot, bumps
+ * head, the server converts into the slot's output area and bumps done.
+ * A side only enters futex() when the other one has announced that it is
+ * about to sleep, so a busy ring runs without system calls.  Several
+ * producers open one ring each; every ring is served by its own worker.
+ * That worker serves nothing else until the ring closes, so the server
+ * refuses a ring that would take its last free worker: with -t N at most
+ * N - 1 rings are open at once, and -t 1 serves none.
+ */
+#define CODEC_RING_MAGIC (0x52434443) /* "CDCR" */
+#define CODEC_RING_MAX_SLOTS (1024)
+#define CODEC_RING_MAX_SLOT_SIZE (16U * 1024 * 1024)
+
+struct codec_ring_cfg {
+    uint32_t slots;     /* Power of two. */
+    uint32_t slot_size; /* Input bytes per slot. */
+};
+
+struct codec_ring_slot {
+    uint8_t codec; /* enum codec_id */
+    uint8_t op;    /* CODEC_OP_ENCODE or CODEC_OP_DECODE */
+    uint16_t flags;
+    int32_t status;
+    uint32_t in_len;
+    uint32_t out_len;
+};
+
+struct codec_ring_hdr {
+    uint32_t magic;
+    uint32_t slots;
+    uint32_t in_size;  /* Input area per slot. */
+    uint32_t out_size; /* Output area per slot, large enough for any codec. */
+    uint64_t slot_off; /* Offset of the slot table. */
+    uint64_t data_off; /* Offset of the first slot's input area. */
+    uint32_t closed;   /* Set by the client when it is done. */
+
+    /* Written by the client. */
+    uint32_t head __attribute__((aligned(64)));
+    uint32_t srv_sleeping;
+
+    /* Written by the server. */
+    uint32_t done __attribute__((aligned(64)));
+    uint32_t cli_sleeping;
+};
+
+struct codec_ring {
+    int sock; /* Keeps the server worker attached. */
+    struct codec_ring_hdr *hdr;
+    size_t map_len;
+    uint32_t submitted;
+    uint32_t consumed;
+    bool holding; /* The oldest slot was returned by complete and is still being read. */
+};
+
+struct codec_ring *codec_ring_open(const char *path, uint32_t slots, uint32_t slot_size);
+void codec_ring_close(struct codec_ring *ring);
+
+/* Input area of the next free slot, NULL when every slot is in flight. */
+uint8_t *codec_ring_slot_in(struct codec_ring *ring);
+int32_t codec_ring_submit(struct codec_ring *ring, uint8_t codec, bool is_decode, uint32_t len);
+/*
+ * Waits for the oldest request in flight.  Returns its output length and
+ * points out at the result inside the ring, valid until the next call.
+ */
+int32_t codec_ring_complete(struct codec_ring *ring, const uint8_t **out);
+/* Submitted requests not yet returned by codec_ring_complete(). */
+uint32_t codec_ring_pending(const struct codec_ring *ring);
+
+/* Server side, serves one ring on an accepted connection until the client closes it. */
+int32_t codec_ring_serve(int sock, const struct codec_ring_cfg *cfg);
+
+#endif
@@ -0,0 +1,49 @@
+#!/bin/sh
+#
+# Localhost client/server round trip: client_server.sh <base64 binary>
+#
+# Starts a two worker server (one may serve a ring) and pushes a batch of
+# eight 90 KB inputs (the largest whose encoding still fits one argument)
+# through -C, far more than the socket buffers hold, then decodes the results
+# again, over the socket and over the shared memory ring.
+
+B64=$1
+WORK=$(mktemp -d)
+SOCK=${WORK}/codec.sock
+SERVER=
+
+cleanup() {
+    [ -n "${SERVER}" ] && kill ${SERVER} 2>/dev/null
+    rm -rf ${WORK}
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+${B64} -S ${SOCK} -t 2 2>/dev/null &
+SERVER=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S ${SOCK} ] && break
+    sleep 0.2
+done
+[ -S ${SOCK} ] || fail "server did not start"
+
+INPUT=$(head -c 90000 /dev/zero | tr '\0' 'a')
+set -- "${INPUT}" "${INPUT}" "${INPUT}" "${INPUT}" "${INPUT}" "${INPUT}" "${INPUT}" "${INPUT}"
+
+timeout 20 ${B64} -C ${SOCK} "$@" >${WORK}/enc 2>/dev/null || fail "socket batch encode"
+[ $(wc -l <${WORK}/enc) -eq 8 ] || fail "socket batch result count"
+for line in $(cat ${WORK}/enc); do
+    [ "$(${B64} -d "${line}" 2>/dev/null)" = "${INPUT}" ] || fail "socket batch result"
+done
+
+timeout 20 ${B64} -C ${SOCK} -d $(cat ${WORK}/enc) >${WORK}/dec 2>/dev/null || fail "socket batch decode"
+[ "$(head -n 1 ${WORK}/dec)" = "${INPUT}" ] && [ $(wc -l <${WORK}/dec) -eq 8 ] || fail "socket batch decode result"
+
+timeout 20 ${B64} -C ${SOCK} -r "$@" >${WORK}/ring 2>/dev/null || fail "ring batch encode"
+cmp -s ${WORK}/enc ${WORK}/ring || fail "ring batch result"
+
+echo "PASS"
@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "codec.h"
+#include "base16.h"
+#include "base32.h"
+#include "base64.h"
+#include "base85.h"
+
+/*
+ * Codec vectors and codec_stream_* checks: codec_test
+ *
+ * Every vector is encoded and decoded one-shot and through a stream split
+ * at each position of its input.  Then 1 MB of random data is encoded in
+ * uneven pieces and decoded again wrapped at 76 columns, for every codec.
+ */
+
+struct codec_vector {
+    const struct codec_ops *ops;
+    const char *plain;
+    size_t plain_len;
+    const char *encoded;
+};
+
+#define VEC(ops, plain, encoded) {&(ops), (plain), sizeof(plain) - 1, (encoded)}
+
+static const struct codec_vector codec_vectors[] = {
+    /* RFC 4648 section 10. */
+    VEC(base64_ops, "", ""),
+    VEC(base64_ops, "f", "Zg=="),
+    VEC(base64_ops, "fo", "Zm8="),
+    VEC(base64_ops, "foo", "Zm9v"),
+    VEC(base64_ops, "foob", "Zm9vYg=="),
+    VEC(base64_ops, "fooba", "Zm9vYmE="),
+    VEC(base64_ops, "foobar", "Zm9vYmFy"),
+    VEC(base64_ct_ops, "foobar", "Zm9vYmFy"),
+    VEC(base64_ct_ops, "fooba", "Zm9vYmE="),
+    VEC(base32_ops, "", ""),
+    VEC(base32_ops, "f", "MY======"),
+    VEC(base32_ops, "fo", "MZXQ===="),
+    VEC(base32_ops, "foo", "MZXW6==="),
+    VEC(base32_ops, "foob", "MZXW6YQ="),
+    VEC(base32_ops, "fooba", "MZXW6YTB"),
+    VEC(base32_ops, "foobar", "MZXW6YTBOI======"),
+    VEC(base16_ops, "", ""),
+    VEC(base16_ops, "f", "66"),
+    VEC(base16_ops, "foobar", "666F6F626172"),
+    /* Adobe Ascii85, without the <~ ~> delimiters. */
+    VEC(ascii85_ops, "", ""),
+    VEC(ascii85_ops, "Man ", "9jqo^"),
+    VEC(ascii85_ops, "sure.", "F*2M7/c"),
+    VEC(ascii85_ops, "Man is distinguished", "9jqo^BlbD-BleB1DJ+*+F(f,q"),
+    VEC(ascii85_ops, "\0\0\0\0", "z"),
+    VEC(ascii85_ops, "\0\0\0\0\0", "z!!"),
+    VEC(ascii85_ops, "a\0\0\0\0b", "@/p9-!+G"),
+    VEC(ascii85_ops, "\0\0\0\0\0\0\0\0", "zz"),
+    /* ZeroMQ RFC 32. */
+    VEC(z85_ops, "", ""),
+    VEC(z85_ops, "\x86\x4F\xD2\x6F\xB5\x59\xF7\x5B", "HelloWorld"),
+};
+
+static int32_t failures = 0;
+
+static void codec_fail(const struct codec_ops *ops, const char *what, const char *input) {
+    printf("FAIL: %s %s [%s]\n", ops->name, what, input);
+    failures++;
+}
+
+/* Feeds src in two pieces split at split, returns the output length or -1. */
+static int32_t codec_stream_split(const struct codec_ops *ops, bool is_decode, const void *src, size_t srclength,
+                                  size_t split, uint8_t *dest, size_t targsize) {
+    struct codec_stream ctx;
+    size_t total = 0;
+    int32_t ret = 0;
+
+    codec_stream_init(&ctx, ops, is_decode);
+    ret = codec_stream_update(&ctx, src, split, dest, targsize);
+    if (ret < 0) {
+        return -1;
+    }
+    total += ret;
+    ret = codec_stream_update(&ctx, (const uint8_t *)src + split, srclength - split, dest + total, targsize - total);
+    if (ret < 0) {
+        return -1;
+    }
+    total += ret;
+    ret = codec_stream_final(&ctx, dest + total, targsize - total);
+    if (ret < 0) {
+        return -1;
+    }
+    return total + ret;
+}
+
+static void codec_test_vector(const struct codec_vector *v) {
+    const struct codec_ops *ops = v->ops;
+    size_t enc_len = strlen(v->encoded);
+    uint8_t out[128];
+    size_t split = 0;
+    int32_t ret = 0;
+
+    ret = ops->encode(v->plain, v->plain_len, out, sizeof(out));
+    if ((ret != (int32_t)enc_len) || (memcmp(out, v->encoded, enc_len) != 0)) {
+        codec_fail(ops, "encode", v->encoded);
+    }
+    ret = ops->decode(v->encoded, enc_len, out, sizeof(out));
+    if ((ret != (int32_t)v->plain_len) || (memcmp(out, v->plain, v->plain_len) != 0)) {
+        codec_fail(ops, "decode", v->encoded);
+    }
+
+    for (split = 0; split <= v->plain_len; split++) {
+        ret = codec_stream_split(ops, false, v->plain, v->plain_len, split, out, sizeof(out));
+        if ((ret != (int32_t)enc_len) || (memcmp(out, v->encoded, enc_len) != 0)) {
+            codec_fail(ops, "stream encode", v->encoded);
+        }
+    }
+    for (split = 0; split <= enc_len; split++) {
+        ret = codec_stream_split(ops, true, v->encoded, enc_len, split, out, sizeof(out));
+        if ((ret != (int32_t)v->plain_len) || (memcmp(out, v->plain, v->plain_len) != 0)) {
+            codec_fail(ops, "stream decode", v->encoded);
+        }
+    }
+}
+
+static void codec_test_errors(void) {
+    uint8_t out[64];
+
+    /* Z85 takes whole 4 byte groups and whole 5 character groups only. */
+    if (z85_encode("abc", 3, out, sizeof(out)) >= 0) {
+        codec_fail(&z85_ops, "encode accepts", "abc");
+    }
+    if (z85_encode("\x86\x4F\xD2\x6F\xB5", 5, out, sizeof(out)) >= 0) {
+        codec_fail(&z85_ops, "encode accepts", "5 bytes");
+    }
+    if (z85_decode("HelloWorl", 9, out, sizeof(out)) >= 0) {
+        codec_fail(&z85_ops, "decode accepts", "HelloWorl");
+    }
+    if (z85_decode("Hello W", 7, out, sizeof(out)) >= 0) {
+        codec_fail(&z85_ops, "decode accepts", "Hello W");
+    }
+    if (codec_stream_split(&z85_ops, false, "abcdefg", 7, 3, out, sizeof(out)) >= 0) {
+        codec_fail(&z85_ops, "stream encode accepts", "abcdefg");
+    }
+
+    /* A single trailing character, and 'z' inside a group. */
+    if (ascii85_decode("9jqo^B", 6, out, sizeof(out)) >= 0) {
+        codec_fail(&ascii85_ops, "decode accepts", "9jqo^B");
+    }
+    if (ascii85_decode("9jzqo^", 6, out, sizeof(out)) >= 0) {
+        codec_fail(&ascii85_ops, "decode accepts", "9jzqo^");
+    }
+    if (base32_decode("MZXW6Y!B", 8, out, sizeof(out)) >= 0) {
+        codec_fail(&base32_ops, "decode accepts", "MZXW6Y!B");
+    }
+    if (base16_decode("66G6", 4, out, sizeof(out)) >= 0) {
+        codec_fail(&base16_ops, "decode accepts", "66G6");
+    }
+}
+
+#define CODEC_TEST_LEN (1024 * 1024)
+#define CODEC_TEST_WRAP (76)
+
+static uint64_t codec_test_rand(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Encodes in uneven pieces, compares with one-shot, decodes wrapped input. */
+static void codec_test_large(const struct codec_ops *ops, const uint8_t *plain, size_t len) {
+    size_t enc_cap = ops->encode_len(len), wrap_cap = enc_cap + enc_cap / CODEC_TEST_WRAP + 1;
+    uint8_t *oneshot = malloc(enc_cap), *enc = malloc(enc_cap), *wrapped = malloc(wrap_cap);
+    uint8_t *dec = malloc(ops->decode_len(wrap_cap));
+    struct codec_stream ctx;
+    size_t off = 0, chunk = 0, total = 0, enc_len = 0, wrap_len = 0, i = 0;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    int32_t ret = 0;
+
+    if ((oneshot == NULL) || (enc == NULL) || (wrapped == NULL) || (dec == NULL)) {
+        codec_fail(ops, "large", "malloc");
+        goto out;
+    }
+
+    ret = ops->encode(plain, len, oneshot, enc_cap);
+    if (ret < 0) {
+        codec_fail(ops, "large", "encode");
+        goto out;
+    }
+    enc_len = ret;
+
+    codec_stream_init(&ctx, ops, false);
+    for (off = 0; off < len; off += chunk) {
+        chunk = codec_test_rand(&seed) % (2 * CODEC_STREAM_BLOCK) + 1;
+        chunk = (len - off < chunk) ? len - off : chunk;
+        ret = codec_stream_update(&ctx, plain + off, chunk, enc + total, enc_cap - total);
+        if (ret < 0) {
+            codec_fail(ops, "large", "stream encode");
+            goto out;
+        }
+        total += ret;
+    }
+    ret = codec_stream_final(&ctx, enc + total, enc_cap - total);
+    if ((ret < 0) || (total + ret != enc_len) || (memcmp(enc, oneshot, enc_len) != 0)) {
+        codec_fail(ops, "large", "stream encode differs from one-shot");
+        goto out;
+    }
+
+    for (i = 0; i < enc_len; i += CODEC_TEST_WRAP) {
+        chunk = (enc_len - i < CODEC_TEST_WRAP) ? enc_len - i : CODEC_TEST_WRAP;
+        memcpy(wrapped + wrap_len, enc + i, chunk);
+        wrap_len += chunk;
+        wrapped[wrap_len++] = '\n';
+    }
+
+    ret = ops->decode(wrapped, wrap_len, dec, ops->decode_len(wrap_len));
+    if ((ret != (int32_t)len) || (memcmp(dec, plain, len) != 0)) {
+        codec_fail(ops, "large", "decode wrapped");
+        goto out;
+    }
+
+    codec_stream_init(&ctx, ops, true);
+    for (off = 0, total = 0; off < wrap_len; off += chunk) {
+        chunk = codec_test_rand(&seed) % (2 * CODEC_STREAM_BLOCK) + 1;
+        chunk = (wrap_len - off < chunk) ? wrap_len - off : chunk;
+        ret = codec_stream_update(&ctx, wrapped + off, chunk, dec + total, ops->decode_len(wrap_len) - total);
+        if (ret < 0) {
+            codec_fail(ops, "large", "stream decode");
+            goto out;
+        }
+        total += ret;
+    }
+    ret = codec_stream_final(&ctx, dec + total, ops->decode_len(wrap_len) - total);
+    if ((ret < 0) || (total + ret != len) || (memcmp(dec, plain, len) != 0)) {
+        codec_fail(ops, "large", "stream decode wrapped");
+    }
+
+out:
+    free(oneshot);
+    free(enc);
+    free(wrapped);
+    free(dec);
+}
+
+int main(void) {
+    static const struct codec_ops *all[] = {&base64_ops, &base64_ct_ops, &base32_ops,
+                                            &base16_ops, &ascii85_ops,   &z85_ops};
+    uint8_t *plain = malloc(CODEC_TEST_LEN);
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    size_t i = 0;
+
+    if (plain == NULL) {
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(codec_vectors) / sizeof(codec_vectors[0]); i++) {
+        codec_test_vector(&codec_vectors[i]);
+    }
+    codec_test_errors();
+
+    /* Random data with zero runs, so Ascii85 mixes 'z' and full groups. */
+    for (i = 0; i < CODEC_TEST_LEN; i++) {
+        plain[i] = (i % 4096 < 1024) ? 0 : (uint8_t)codec_test_rand(&seed);
+    }
+    for (i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+        codec_test_large(all[i], plain, CODEC_TEST_LEN);
+    }
+    free(plain);
+
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,40 @@
+#!/bin/sh
+#
+# Large file round trip: large_roundtrip.sh <tools dir>
+#
+# Encodes and decodes inputs of several chunks (over 8 MiB) with every tool
+# at -t 1 and -t 4: all zeros, which Ascii85 shortens to 'z' groups, and a
+# mix of zero and random runs.  Encoded output must not contain NUL bytes.
+
+TOOLS=$1
+WORK=$(mktemp -d)
+trap 'rm -rf ${WORK}' EXIT
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+head -c 20000000 /dev/zero >${WORK}/zero
+for i in 1 2 3; do
+    head -c 3000000 /dev/zero
+    head -c 3000000 /dev/urandom
+done >${WORK}/mixed
+
+for tool in base64 base16 base32 base85 z85; do
+    for input in zero mixed; do
+        for t in 1 4; do
+            name="${tool} ${input} -t ${t}"
+            ${TOOLS}/${tool} -t ${t} -f ${WORK}/${input} -o ${WORK}/enc 2>/dev/null || fail "${name} encode"
+            [ $(tr -cd '\000' <${WORK}/enc | wc -c) -eq 0 ] || fail "${name} NUL bytes in output"
+            ${TOOLS}/${tool} -d -t ${t} -f ${WORK}/enc -o ${WORK}/dec 2>/dev/null || fail "${name} decode"
+            cmp -s ${WORK}/${input} ${WORK}/dec || fail "${name} round trip"
+        done
+    done
+done
+
+# 20 MB of zeros is 5,000,000 'z' groups.
+${TOOLS}/base85 -f ${WORK}/zero -o ${WORK}/enc 2>/dev/null
+[ $(wc -c <${WORK}/enc) -eq 5000000 ] || fail "base85 zero length"
+
+echo "PASS"
@@ -0,0 +1,37 @@
+#!/bin/sh
+#
+# Random access round trip: range.sh <tools dir>
+#
+# For every indexable codec, encodes 300 KB into one dense line and into a
+# copy wrapped at 76 columns, indexes both (a dense index and a scanned one)
+# and checks --range slices inside one block, across blocks and at the end
+# against the original bytes.
+
+TOOLS=$1
+WORK=$(mktemp -d)
+trap 'rm -rf ${WORK}' EXIT
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+head -c 300000 /dev/urandom >${WORK}/data
+
+for tool in base64 base16 base32 z85; do
+    ${TOOLS}/${tool} -f ${WORK}/data -o ${WORK}/dense 2>/dev/null || fail "${tool} encode"
+    fold -w 76 ${WORK}/dense >${WORK}/wrapped
+    for layout in dense wrapped; do
+        ${TOOLS}/${tool} --index -f ${WORK}/${layout} 2>/dev/null || fail "${tool} ${layout} index"
+        for range in 0:4 1:100 16380:10 49000:1000 100000:150000 299990:100; do
+            start=${range%:*}
+            len=${range#*:}
+            ${TOOLS}/${tool} --range=${range} -f ${WORK}/${layout} >${WORK}/part 2>/dev/null ||
+                fail "${tool} ${layout} --range=${range}"
+            tail -c +$((start + 1)) ${WORK}/data | head -c ${len} | cmp -s - ${WORK}/part ||
+                fail "${tool} ${layout} --range=${range} bytes"
+        done
+    done
+done
+
+echo "PASS"